@@ -0,0 +1,40 @@
+#pragma once
+
+#include <span>
+
+#include "Position.h"
+
+namespace Checkers::Corpus
+{
+
+struct Category
+{
+	const char *Name;
+	std::span<const Position> Positions;
+};
+
+static inline constexpr Position Openings[] = {
+	StartingPosition,
+	{ 0x00000fffu, 0xffe10000u, Board::Empty, 0, true },
+	{ 0x00002dffu, 0xffe10000u, Board::Empty, 0, false },
+};
+
+static inline constexpr Position Middlegames[] = {
+	{ 0x00002566u, 0x4b640000u, Board::Empty, 0, false },
+	{ 0x0000ca19u, 0x349a0000u, Board::Empty, 0, true },
+	{ 0x000034a4u, 0x82690000u, Board::Empty, 0, false },
+};
+
+static inline constexpr Position QueenEndgames[] = {
+	{ 0x00000201u, 0x80400000u, 0x80000001u, 0, false },
+	{ 0x00006010u, 0x08200000u, 0x08002010u, 0, true },
+	{ 0x10000042u, 0x41020000u, 0x51000000u, 0, false },
+};
+
+static inline constexpr Category Categories[] = {
+	{ "opening", Openings },
+	{ "middlegame", Middlegames },
+	{ "queen-endgame", QueenEndgames },
+};
+
+}
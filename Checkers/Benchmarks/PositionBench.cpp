@@ -0,0 +1,175 @@
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Core/Core.h"
+#include "Position.h"
+#include "PositionGenerator.h"
+
+using namespace Checkers;
+
+struct BenchOptions
+{
+	size_t Count = 4096;
+	int Passes = 200;
+	int Pieces = 12;
+	int Queens = 3;
+	unsigned int Seed = 1;
+};
+
+struct Sample
+{
+	Checkers::Position Position;
+
+	// A single piece of the side to move, capturing if the position has a capture
+	Bitboard From;
+
+	// A legal single capture, -1 if the position has none
+	int CaptureFrom, CaptureTo;
+};
+
+struct SampleSet
+{
+	std::string Name;
+	std::vector<Sample> Samples;
+	std::vector<Sample> CaptureSamples;
+};
+
+static volatile Bitboard s_Sink;
+
+static Sample MakeSample(const Position &position, HostGenerator &generator)
+{
+	Sample sample = { .Position = position, .CaptureFrom = -1, .CaptureTo = -1 };
+
+	Bitboard capturing = position.GetAllCapturing();
+	if (capturing)
+	{
+		sample.CaptureFrom = Board::RandomBit(generator, capturing);
+		sample.CaptureTo = Board::RandomBit(generator, position.GetCaptures(Board::FromIndex(sample.CaptureFrom)));
+		sample.From = Board::FromIndex(sample.CaptureFrom);
+	}
+	else
+		sample.From = Board::FromIndex(Board::RandomBit(generator, position.GetAllMoving()));
+
+	return sample;
+}
+
+static SampleSet MakeSampleSet(const char *name, size_t count, int pieces, int queens, unsigned int seed)
+{
+	PositionGenerator positions(seed);
+	HostGenerator generator(seed + 1);
+
+	SampleSet set = { .Name = name };
+
+	// Positions with captures are collected separately for the Capture benchmark
+	while (set.Samples.size() < count || set.CaptureSamples.size() < count)
+	{
+		for (const Position &position : positions.Generate(count, pieces, queens))
+		{
+			Sample sample = MakeSample(position, generator);
+
+			if (set.Samples.size() < count)
+				set.Samples.push_back(sample);
+
+			if (sample.CaptureFrom != -1 && set.CaptureSamples.size() < count)
+				set.CaptureSamples.push_back(sample);
+		}
+	}
+
+	return set;
+}
+
+template<typename F>
+static double Measure(const std::vector<Sample> &samples, int passes, F &&function)
+{
+	Bitboard sink = 0;
+
+	std::chrono::time_point start(std::chrono::steady_clock::now());
+	for (int pass = 0; pass < passes; pass++)
+		for (const Sample &sample : samples)
+			sink ^= function(sample);
+	std::chrono::time_point end(std::chrono::steady_clock::now());
+
+	s_Sink = sink;
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / (samples.size() * (double)passes);
+}
+
+static double MeasureTimerScope(int count)
+{
+	std::chrono::time_point start(std::chrono::steady_clock::now());
+	for (int i = 0; i < count; i++)
+	{
+		Timer<"Benchmark Scope"> timer;
+	}
+	std::chrono::time_point end(std::chrono::steady_clock::now());
+
+	return std::chrono::duration<double, std::nano>(end - start).count() / count;
+}
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: checkers_position_bench [--count n] [--passes n] [--pieces n] [--queens n] [--seed n]\n";
+}
+
+int main(int argc, char *argv[])
+{
+	BenchOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(argv[i], "--count") == 0 && hasValue)
+			options.Count = std::stoul(argv[++i]);
+		else if (std::strcmp(argv[i], "--passes") == 0 && hasValue)
+			options.Passes = std::stoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--pieces") == 0 && hasValue)
+			options.Pieces = std::stoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--queens") == 0 && hasValue)
+			options.Queens = std::stoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+			options.Seed = std::stoul(argv[++i]);
+		else
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	SampleSet sets[] = {
+		MakeSampleSet("men only", options.Count, options.Pieces, 0, options.Seed),
+		MakeSampleSet("with queens", options.Count, options.Pieces, options.Queens, options.Seed),
+	};
+
+	std::cout << std::format("seed {}, {} positions with {} pieces, {} passes\n\n", options.Seed, options.Count, options.Pieces, options.Passes);
+	std::cout << std::format("{:<16} {:>14} {:>14}\n", "ns/call", sets[0].Name, std::format("{} queens", options.Queens));
+
+	auto report = [&](const char *name, bool captures, auto &&function) {
+		double results[2];
+		for (int i = 0; i < 2; i++)
+			results[i] = Measure(captures ? sets[i].CaptureSamples : sets[i].Samples, options.Passes, function);
+
+		std::cout << std::format("{:<16} {:>14.2f} {:>14.2f}\n", name, results[0], results[1]);
+	};
+
+	report("GetMoving", false, [](const Sample &sample) { return sample.Position.GetMoving(sample.Position.GetCheckers()); });
+	report("GetMoves", false, [](const Sample &sample) { return sample.Position.GetMoves(sample.From); });
+	report("GetCapturing", false, [](const Sample &sample) { return sample.Position.GetCapturing(sample.Position.GetCheckers()); });
+	report("GetCaptures", true, [](const Sample &sample) { return sample.Position.GetCaptures(sample.From); });
+	report("Capture", true, [](const Sample &sample) {
+		Position position = sample.Position;
+		position.Capture(sample.CaptureFrom, sample.CaptureTo);
+		return position.Black ^ position.White ^ position.Queens;
+	});
+	report("HasLost", false, [](const Sample &sample) { return (Bitboard)sample.Position.HasLost(); });
+
+	// Overhead of an instrumented scope, compiled out without CHECKERS_ENABLE_TIMERS
+	std::cout << std::format("\n{:<16} {:>14.2f}\n", "Timer scope", MeasureTimerScope(10000000));
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Controllers/Simulator.h"
+
+#include "Corpus.h"
+
+using namespace Checkers;
+
+struct BenchOptions
+{
+	std::vector<std::string> Backends = {};
+	std::vector<unsigned int> BatchSizes = { 1, 16, 64, 256 };
+	std::vector<unsigned int> ThreadCounts = {};
+	std::chrono::milliseconds Duration = std::chrono::milliseconds(250);
+	std::string JsonPath = {};
+};
+
+struct BenchResult
+{
+	std::string Backend;
+	std::string Category;
+	unsigned int BatchSize;
+	unsigned int ThreadCount;
+
+	uint64_t Batches;
+	uint64_t Playouts;
+	uint64_t Plies;
+	double Seconds;
+
+	double LatencyP50Us;
+	double LatencyP99Us;
+};
+
+static std::vector<unsigned int> ParseList(const char *list)
+{
+	std::vector<unsigned int> values;
+
+	std::stringstream stream(list);
+	for (std::string value; std::getline(stream, value, ',');)
+		values.push_back(std::stoul(value));
+
+	return values;
+}
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: checkers_bench [--backend name]... [--batch 1,16,64] [--threads 1,2,4] [--time ms] [--json file]\n";
+}
+
+static double Percentile(std::vector<double> &values, double fraction)
+{
+	if (values.empty())
+		return 0.0;
+
+	size_t index = std::min<size_t>(values.size() * fraction, values.size() - 1);
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+static BenchResult Run(const SimulatorBackend &backend, const Corpus::Category &category, unsigned int batchSize, unsigned int threadCount, std::chrono::milliseconds duration)
+{
+	std::unique_ptr<Simulator> simulator(backend.Create(batchSize, threadCount));
+
+	std::vector<Position> positions(batchSize);
+	for (unsigned int i = 0; i < batchSize; i++)
+		positions[i] = category.Positions[i % category.Positions.size()];
+
+	std::vector<int> blackInc(batchSize), whiteInc(batchSize), visitsInc(batchSize);
+
+	// One untimed batch so that lazily created resources don't count
+	simulator->Simulate(positions, blackInc, whiteInc, visitsInc);
+
+	BenchResult result = {
+		.Backend = backend.Name,
+		.Category = category.Name,
+		.BatchSize = batchSize,
+		.ThreadCount = threadCount,
+	};
+
+	std::vector<double> latencies;
+	const uint64_t startPlies = simulator->GetPlyCount();
+
+	std::chrono::time_point start(std::chrono::steady_clock::now());
+	std::chrono::time_point now = start;
+	while (now - start < duration)
+	{
+		simulator->Simulate(positions, blackInc, whiteInc, visitsInc);
+
+		std::chrono::time_point end(std::chrono::steady_clock::now());
+		latencies.push_back(std::chrono::duration<double, std::micro>(end - now).count());
+		now = end;
+
+		for (int visits : visitsInc)
+			result.Playouts += visits / 2;
+		result.Batches++;
+	}
+
+	result.Seconds = std::chrono::duration<double>(now - start).count();
+	result.Plies = simulator->GetPlyCount() - startPlies;
+	result.LatencyP50Us = Percentile(latencies, 0.50);
+	result.LatencyP99Us = Percentile(latencies, 0.99);
+
+	return result;
+}
+
+static void PrintText(const BenchResult &result)
+{
+	const double playoutsPerSecond = result.Playouts / result.Seconds;
+
+	std::string plies = "n/a", length = "n/a";
+	if (result.Plies != 0)
+	{
+		plies = std::format("{:.3e}", result.Plies / result.Seconds);
+		length = std::format("{:.1f}", result.Plies / (double)result.Playouts);
+	}
+
+	std::cout << std::format("{:<10} {:<14} {:>6} {:>8} {:>12.3e} {:>12} {:>8} {:>12.1f} {:>12.1f}\n",
+		result.Backend, result.Category, result.BatchSize, result.ThreadCount,
+		playoutsPerSecond, plies, length, result.LatencyP50Us, result.LatencyP99Us
+	);
+}
+
+static void WriteJson(std::ostream &out, const std::vector<BenchResult> &results)
+{
+	out << "{\n\t\"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult &result = results[i];
+
+		out << std::format(
+			"\t\t{{ \"backend\": \"{}\", \"category\": \"{}\", \"batch_size\": {}, \"threads\": {}, \"batches\": {}, "
+			"\"playouts\": {}, \"plies\": {}, \"seconds\": {:.6f}, \"playouts_per_sec\": {:.1f}, \"plies_per_sec\": {:.1f}, "
+			"\"avg_playout_length\": {:.3f}, \"latency_p50_us\": {:.3f}, \"latency_p99_us\": {:.3f} }}{}\n",
+			result.Backend, result.Category, result.BatchSize, result.ThreadCount, result.Batches,
+			result.Playouts, result.Plies, result.Seconds, result.Playouts / result.Seconds, result.Plies / result.Seconds,
+			result.Playouts == 0 ? 0.0 : result.Plies / (double)result.Playouts, result.LatencyP50Us, result.LatencyP99Us,
+			i + 1 == results.size() ? "" : ","
+		);
+	}
+	out << "\t]\n}\n";
+}
+
+int main(int argc, char *argv[])
+{
+	BenchOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(argv[i], "--backend") == 0 && hasValue)
+			options.Backends.push_back(argv[++i]);
+		else if (std::strcmp(argv[i], "--batch") == 0 && hasValue)
+			options.BatchSizes = ParseList(argv[++i]);
+		else if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+			options.ThreadCounts = ParseList(argv[++i]);
+		else if (std::strcmp(argv[i], "--time") == 0 && hasValue)
+			options.Duration = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--json") == 0 && hasValue)
+			options.JsonPath = argv[++i];
+		else
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (options.ThreadCounts.empty())
+	{
+		const unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		for (unsigned int threads = 1; threads < hardwareThreads; threads *= 2)
+			options.ThreadCounts.push_back(threads);
+		options.ThreadCounts.push_back(hardwareThreads);
+	}
+
+	for (const Corpus::Category &category : Corpus::Categories)
+		for (const Position &position : category.Positions)
+			if (position.HasLost() || position.IsDraw())
+			{
+				std::cerr << "Corpus position in category " << category.Name << " is terminal\n";
+				return EXIT_FAILURE;
+			}
+
+	std::cout << std::format("{:<10} {:<14} {:>6} {:>8} {:>12} {:>12} {:>8} {:>12} {:>12}\n",
+		"backend", "category", "batch", "threads", "playouts/s", "plies/s", "length", "p50 [us]", "p99 [us]"
+	);
+
+	std::vector<BenchResult> results;
+	for (const SimulatorBackend &backend : Simulator::GetBackends())
+	{
+		if (!options.Backends.empty() && std::find(options.Backends.begin(), options.Backends.end(), backend.Name) == options.Backends.end())
+			continue;
+
+		for (const Corpus::Category &category : Corpus::Categories)
+			for (unsigned int batchSize : options.BatchSizes)
+				for (unsigned int threadCount : options.ThreadCounts)
+				{
+					results.push_back(Run(backend, category, batchSize, threadCount, options.Duration));
+					PrintText(results.back());
+				}
+	}
+
+	if (!options.JsonPath.empty())
+	{
+		if (options.JsonPath == "-")
+			WriteJson(std::cout, results);
+		else
+		{
+			std::ofstream file(options.JsonPath);
+			WriteJson(file, results);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
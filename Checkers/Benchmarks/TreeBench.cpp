@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Controllers/MCTS.h"
+#include "Core/Arena.h"
+#include "Core/PerfCounters.h"
+
+namespace Checkers
+{
+
+// Returns immediately, so that only the tree operations are measured
+class NullSimulator : public Simulator
+{
+public:
+	void Simulate(const std::vector<Position> &positions, std::vector<int> &blackInc, std::vector<int> &whiteInc, std::vector<int> &visitsInc) override
+	{
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			blackInc[i] = i % 3;
+			whiteInc[i] = 2 - blackInc[i];
+			visitsInc[i] = 2;
+		}
+	}
+};
+
+enum class TreeLayout
+{
+	// Order of Build, siblings next to each other and levels one after another
+	BreadthFirst,
+
+	// Scattered like allocation order in a real search
+	Shuffled,
+
+	// Shuffled and then reordered like a long search does, hot paths next to each other
+	DepthFirst
+};
+
+struct TreeBenchResult
+{
+	size_t NodeCount;
+	int Iterations;
+	size_t BytesPerNode;
+
+	double SelectionNs, ExpansionNs, BackPropagationNs;
+	double IterationsPerSecond;
+
+	bool HasCounters;
+	double L1DMisses, LLCMisses, DTLBMisses;
+};
+
+class TreeBench
+{
+public:
+	// Tree of real positions, every node has up to branching of its moves
+	static void Build(Tree &tree, size_t nodeCount, int branching, bool compact, TreeLayout layout, unsigned int seed)
+	{
+		std::mt19937 engine(seed);
+
+		tree.SetCompactNodes(compact);
+		tree.m_Root = StartingPosition;
+		tree.m_Nodes.reserve(nodeCount);
+		tree.m_VirtualLoss.reserve(nodeCount);
+		tree.m_Expansions.reserve(nodeCount);
+		tree.m_Positions.reserve(compact ? 0 : nodeCount);
+		tree.m_Nodes.emplace_back(Node{});
+		tree.m_VirtualLoss.emplace_back(0.0f);
+		tree.m_Expansions.emplace_back(Tree::Expansion{});
+		if (!compact)
+			tree.m_Positions.emplace_back(StartingPosition);
+
+		// Positions of all nodes, the tree keeps them only in the full format
+		std::vector<Position> positions(1, StartingPosition);
+
+		for (size_t i = 0; i < positions.size() && tree.m_Nodes.size() < nodeCount; i++)
+		{
+			if (positions[i].HasLost() || positions[i].IsDraw())
+				continue;
+
+			tree.AddChildNodes(i, positions[i], std::min<size_t>(branching, nodeCount - tree.m_Nodes.size()));
+			for (node_index child = tree.m_Nodes[i].Child; child != 0; child = tree.m_Nodes[child].Next)
+				positions.push_back(tree.m_ChildBuffer[tree.m_Expansions[child].Move]);
+
+			// Inner nodes are complete, so that selection doesn't widen them
+			tree.m_Expansions[i].Total = tree.m_Expansions[i].Generated;
+		}
+
+		// Statistics bottom up, children always have larger indices than their parent
+		for (size_t i = tree.m_Nodes.size(); i-- > 0;)
+		{
+			Node &node = tree.m_Nodes[i];
+
+			node.Visits = 2;
+			for (node_index child = node.Child; child != 0; child = tree.m_Nodes[child].Next)
+				node.Visits += tree.m_Nodes[child].Visits;
+
+			node.Wins = std::uniform_int_distribution<uint32_t>(0, node.Visits)(engine);
+		}
+
+		if (layout != TreeLayout::BreadthFirst)
+			Shuffle(tree, engine);
+		if (layout == TreeLayout::DepthFirst)
+			tree.Reorder(0);
+	}
+
+	static TreeBenchResult Run(Tree &tree, int iterations, const PerfCounters &counters)
+	{
+		TreeBenchResult result = {
+			.NodeCount = tree.m_Nodes.size(),
+			.Iterations = iterations,
+			.BytesPerNode = sizeof(Node) + sizeof(float) + sizeof(Tree::Expansion) + (tree.m_CompactNodes ? 0 : sizeof(Position))
+		};
+
+		NullSimulator simulator;
+		Tree::Batch &batch = tree.m_Batches[0];
+
+		// Expansion appends up to a full set of children every iteration
+		tree.m_Nodes.reserve(tree.m_Nodes.size() + iterations * 16ull);
+		tree.m_VirtualLoss.reserve(tree.m_Nodes.capacity());
+		tree.m_Expansions.reserve(tree.m_Nodes.capacity());
+		if (!tree.m_CompactNodes)
+			tree.m_Positions.reserve(tree.m_Nodes.capacity());
+
+		std::chrono::nanoseconds selection(0), expansion(0), backPropagation(0);
+
+		const PerfValues start = counters.Read();
+		const std::chrono::time_point begin(std::chrono::steady_clock::now());
+
+		for (int i = 0; i < iterations; i++)
+		{
+			batch.Paths.clear();
+			batch.Selected.clear();
+
+			Position position;
+			std::chrono::time_point t0(std::chrono::steady_clock::now());
+			node_index index = tree.SelectNode(batch, position);
+			std::chrono::time_point t1(std::chrono::steady_clock::now());
+			tree.Expand(batch, index, position);
+			std::chrono::time_point t2(std::chrono::steady_clock::now());
+
+			batch.BlackInc.resize(batch.Paths.size());
+			batch.WhiteInc.resize(batch.Paths.size());
+			batch.VisitsInc.resize(batch.Paths.size());
+			simulator.Simulate(batch.Selected, batch.BlackInc, batch.WhiteInc, batch.VisitsInc);
+
+			std::chrono::time_point t3(std::chrono::steady_clock::now());
+			tree.BackPropagate(batch);
+			std::chrono::time_point t4(std::chrono::steady_clock::now());
+
+			selection += t1 - t0;
+			expansion += t2 - t1;
+			backPropagation += t4 - t3;
+		}
+
+		const std::chrono::duration<double> elapsed(std::chrono::steady_clock::now() - begin);
+		const PerfValues end = counters.Read();
+
+		result.IterationsPerSecond = iterations / elapsed.count();
+		result.SelectionNs = selection.count() / (double)iterations;
+		result.ExpansionNs = expansion.count() / (double)iterations;
+		result.BackPropagationNs = backPropagation.count() / (double)iterations;
+
+		result.HasCounters = counters.IsAvailable();
+		auto perIteration = [&](PerfEvent event) {
+			return (end[(size_t)event] - start[(size_t)event]) / (double)iterations;
+		};
+		result.L1DMisses = perIteration(PerfEvent::L1DMisses);
+		result.LLCMisses = perIteration(PerfEvent::LLCMisses);
+		result.DTLBMisses = perIteration(PerfEvent::DTLBMisses);
+
+		return result;
+	}
+
+private:
+	static void Shuffle(Tree &tree, std::mt19937 &engine)
+	{
+		const size_t nodeCount = tree.m_Nodes.size();
+
+		// The root stays at index 0
+		std::vector<node_index> remap(nodeCount);
+		std::iota(remap.begin(), remap.end(), 0);
+		std::shuffle(remap.begin() + 1, remap.end(), engine);
+
+		ArenaVector<Node> nodes(nodeCount);
+		ArenaVector<Tree::Expansion> expansions(nodeCount);
+		ArenaVector<Position> positions(tree.m_Positions.size());
+		for (size_t i = 0; i < nodeCount; i++)
+		{
+			Node node = tree.m_Nodes[i];
+			node.Child = node.Child == 0 ? 0 : remap[node.Child];
+			node.Next = node.Next == 0 ? 0 : remap[node.Next];
+			nodes[remap[i]] = node;
+			expansions[remap[i]] = tree.m_Expansions[i];
+			if (!positions.empty())
+				positions[remap[i]] = tree.m_Positions[i];
+		}
+
+		tree.m_Nodes = std::move(nodes);
+		tree.m_Expansions = std::move(expansions);
+		tree.m_Positions = std::move(positions);
+	}
+};
+
+}
+
+using namespace Checkers;
+
+struct BenchOptions
+{
+	std::vector<size_t> Sizes = { 10000, 100000, 1000000, 10000000 };
+	int Branching = 8;
+	int Iterations = 200000;
+	std::vector<TreeLayout> Layouts = { TreeLayout::Shuffled, TreeLayout::DepthFirst };
+	unsigned int Seed = 1;
+
+	// Node formats to compare, full keeps positions in the tree, compact rebuilds them from the moves
+	std::vector<bool> Compact = { false, true };
+
+	// Page modes of the tree arenas to compare
+	std::vector<PageMode> Pages = { PageMode::Default };
+};
+
+static std::vector<size_t> ParseSizes(const char *list)
+{
+	std::vector<size_t> values;
+
+	std::stringstream stream(list);
+	for (std::string value; std::getline(stream, value, ',');)
+		values.push_back((size_t)std::stod(value));
+
+	return values;
+}
+
+static const char *s_LayoutNames[] = { "bfs", "shuffled", "dfs" };
+
+static bool ParseLayouts(const char *list, std::vector<TreeLayout> &layouts)
+{
+	layouts.clear();
+
+	std::stringstream stream(list);
+	for (std::string value; std::getline(stream, value, ',');)
+	{
+		const auto name = std::find(std::begin(s_LayoutNames), std::end(s_LayoutNames), value);
+		if (name == std::end(s_LayoutNames))
+			return false;
+		layouts.push_back((TreeLayout)(name - std::begin(s_LayoutNames)));
+	}
+
+	return !layouts.empty();
+}
+
+static bool ParsePages(const char *list, std::vector<PageMode> &modes)
+{
+	modes.clear();
+
+	std::stringstream stream(list);
+	for (std::string value; std::getline(stream, value, ',');)
+		if (!Arena::ParsePageMode(value.c_str(), modes.emplace_back()))
+			return false;
+
+	return !modes.empty();
+}
+
+// Anonymous memory of the process backed by transparent huge pages, -1 when unknown
+static long long GetAnonHugePagesKiB()
+{
+	std::ifstream file("/proc/self/smaps_rollup");
+	for (std::string line; std::getline(file, line);)
+		if (line.starts_with("AnonHugePages:"))
+			return std::stoll(line.substr(line.find(':') + 1));
+
+	return -1;
+}
+
+// The mode most of the arena bytes mapped since before got, heap when none were mapped
+static const char *GetEffectiveMode(const ArenaStats &before, const ArenaStats &after)
+{
+	const char *name = "heap";
+	uint64_t most = 0;
+	for (size_t i = 0; i < (size_t)PageMode::Count; i++)
+		if (after.Bytes[i] - before.Bytes[i] > most)
+		{
+			most = after.Bytes[i] - before.Bytes[i];
+			name = Arena::GetName((PageMode)i);
+		}
+
+	return name;
+}
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: checkers_tree_bench [--sizes 1e4,1e5,1e6] [--branching n] [--iterations n] [--layout bfs,shuffled,dfs] [--seed n] [--format full|compact] [--pages default,transparent,explicit]\n";
+}
+
+int main(int argc, char *argv[])
+{
+	BenchOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(argv[i], "--sizes") == 0 && hasValue)
+			options.Sizes = ParseSizes(argv[++i]);
+		else if (std::strcmp(argv[i], "--branching") == 0 && hasValue)
+			options.Branching = std::max(std::stoi(argv[++i]), 1);
+		else if (std::strcmp(argv[i], "--iterations") == 0 && hasValue)
+			options.Iterations = std::stoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--layout") == 0 && hasValue && ParseLayouts(argv[i + 1], options.Layouts))
+			i++;
+		else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+			options.Seed = std::stoul(argv[++i]);
+		else if (std::strcmp(argv[i], "--format") == 0 && hasValue && std::strcmp(argv[i + 1], "full") == 0)
+		{
+			options.Compact = { false };
+			i++;
+		}
+		else if (std::strcmp(argv[i], "--format") == 0 && hasValue && std::strcmp(argv[i + 1], "compact") == 0)
+		{
+			options.Compact = { true };
+			i++;
+		}
+		else if (std::strcmp(argv[i], "--pages") == 0 && hasValue && ParsePages(argv[i + 1], options.Pages))
+			i++;
+		else
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	PerfCounters counters;
+	if (!counters.IsAvailable())
+		std::cout << "Hardware counters unavailable (perf_event_open not permitted), cache misses are not reported\n";
+
+	std::cout << std::format("{:>8} {:>9} {:>12} {:>12} {:>12} {:>8} {:>12} {:>12} {:>12} {:>12} {:>12} {:>12} {:>12} {:>12}\n",
+		"format", "layout", "pages", "nodes", "bytes/node", "THP MiB", "select [ns]", "expand [ns]", "backprop [ns]", "total [ns]", "it/s", "L1D miss/it", "LLC miss/it", "dTLB miss/it"
+	);
+
+	for (size_t size : options.Sizes)
+		for (bool compact : options.Compact)
+			for (TreeLayout layout : options.Layouts)
+				for (PageMode pages : options.Pages)
+				{
+					Arena::SetPageMode(pages);
+					const ArenaStats before = Arena::GetStats();
+
+					NullSimulator simulator;
+					Tree tree(&simulator, options.Iterations, std::chrono::milliseconds(0), 1);
+
+					TreeBench::Build(tree, std::max<size_t>(size, 1), options.Branching, compact, layout, options.Seed);
+					TreeBenchResult result = TreeBench::Run(tree, options.Iterations, counters);
+
+					auto misses = [&](double value) {
+						return result.HasCounters ? std::format("{:.2f}", value) : std::string("n/a");
+					};
+
+					// Includes other memory of the process, but the tree dominates it
+					const long long hugePages = GetAnonHugePagesKiB();
+
+					std::cout << std::format("{:>8} {:>9} {:>12} {:>12} {:>12} {:>8} {:>12.1f} {:>12.1f} {:>12.1f} {:>12.1f} {:>12.0f} {:>12} {:>12} {:>12}\n",
+						compact ? "compact" : "full", s_LayoutNames[(size_t)layout], GetEffectiveMode(before, Arena::GetStats()), result.NodeCount, result.BytesPerNode,
+						hugePages < 0 ? std::string("n/a") : std::to_string(hugePages / 1024),
+						result.SelectionNs, result.ExpansionNs, result.BackPropagationNs,
+						result.SelectionNs + result.ExpansionNs + result.BackPropagationNs, result.IterationsPerSecond,
+						misses(result.L1DMisses), misses(result.LLCMisses), misses(result.DTLBMisses)
+					);
+				}
+
+	Arena::SetPageMode(PageMode::Default);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,362 @@
+#include <algorithm>
+#include <cassert>
+#include <format>
+
+#include "Core/Instrumentation.h"
+
+#include "BatchingSimulator.h"
+
+namespace Checkers
+{
+
+SimulationBatcher::SimulationBatcher(Simulator *simulator, size_t batchSize, std::chrono::microseconds maxDelay)
+	: m_Simulator(simulator), m_BatchSize(std::max<size_t>(batchSize, 1)), m_MaxDelay(maxDelay)
+{
+	m_Dispatcher = std::thread(&SimulationBatcher::DispatchLoop, this);
+}
+
+SimulationBatcher::~SimulationBatcher()
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_RequestQueued.notify_all();
+
+	m_Dispatcher.join();
+}
+
+Simulator *SimulationBatcher::CreateClient(std::string name, unsigned int weight, int priority)
+{
+	std::lock_guard lock(m_Mutex);
+
+	const ClientId id = m_NextClient++;
+
+	Client &client = m_Clients[id];
+	client.Name = name.empty() ? std::format("Client {}", id) : std::move(name);
+	client.Weight = std::max(weight, 1u);
+	client.Priority = priority;
+	client.VirtualTime = m_VirtualTime;
+	client.Created = std::chrono::steady_clock::now();
+
+	return new BatchingSimulator(*this, id);
+}
+
+BatchingStats SimulationBatcher::GetStats() const
+{
+	std::lock_guard lock(m_Mutex);
+
+	return BatchingStats{
+		.Batches = m_Batches,
+		.Positions = m_Positions,
+		.Requests = m_RequestCount,
+		.QueuedPositions = m_QueuedPositions,
+		.FillRatio = m_Batches == 0 ? 0.0 : m_Positions / (double)(m_Batches * m_BatchSize)
+	};
+}
+
+std::vector<BatchingClientStats> SimulationBatcher::GetClientStats() const
+{
+	std::lock_guard lock(m_Mutex);
+
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	std::vector<BatchingClientStats> stats;
+	for (const auto &[id, client] : m_Clients)
+	{
+		const std::chrono::duration<double> lifetime = now - client.Created;
+
+		stats.push_back(BatchingClientStats{
+			.Name = client.Name,
+			.Weight = client.Weight,
+			.Priority = client.Priority,
+			.Requests = client.Requests,
+			.Positions = client.Positions,
+			.Utilization = lifetime.count() == 0.0 ? 0.0 : std::chrono::duration<double>(client.Busy) / lifetime,
+			.AverageWait = std::chrono::duration_cast<std::chrono::microseconds>(client.Requests == 0 ? std::chrono::nanoseconds(0) : client.Wait / (int64_t)client.Requests)
+		});
+	}
+
+	std::sort(stats.begin(), stats.end(), [](const BatchingClientStats &a, const BatchingClientStats &b) { return a.Name < b.Name; });
+	return stats;
+}
+
+void SimulationBatcher::RemoveClient(ClientId id)
+{
+	std::lock_guard lock(m_Mutex);
+
+	auto it = m_Clients.find(id);
+	if (it == m_Clients.end())
+		return;
+
+	// Requests in the batch being simulated are dropped when it completes
+	for (SimulationTicket ticket : it->second.Queue)
+	{
+		m_QueuedPositions -= m_Requests[ticket].Positions.size();
+		m_Requests.erase(ticket);
+	}
+	std::erase_if(m_Requests, [&](const auto &request) { return request.second.Client == id; });
+
+	m_Clients.erase(it);
+}
+
+void SimulationBatcher::Cancel(ClientId id)
+{
+	std::unique_lock lock(m_Mutex);
+
+	auto it = m_Clients.find(id);
+	if (it == m_Clients.end() || it->second.Queue.empty())
+		return;
+
+	for (SimulationTicket ticket : it->second.Queue)
+	{
+		Request &request = m_Requests[ticket];
+		const size_t count = request.Positions.size();
+
+		request.BlackInc.assign(count, 0);
+		request.WhiteInc.assign(count, 0);
+		request.VisitsInc.assign(count, 0);
+		request.Done = true;
+
+		m_QueuedPositions -= count;
+	}
+	it->second.Queue.clear();
+
+	lock.unlock();
+	m_RequestDone.notify_all();
+}
+
+void SimulationBatcher::SetPriority(ClientId id, int priority)
+{
+	std::lock_guard lock(m_Mutex);
+
+	auto it = m_Clients.find(id);
+	if (it != m_Clients.end())
+		it->second.Priority = priority;
+}
+
+SimulationTicket SimulationBatcher::Enqueue(ClientId id, std::span<const Position> positions)
+{
+	std::unique_lock lock(m_Mutex);
+
+	const SimulationTicket ticket = m_NextTicket++;
+
+	Request &request = m_Requests[ticket];
+	request.Client = id;
+	request.Positions.assign(positions.begin(), positions.end());
+	request.Queued = std::chrono::steady_clock::now();
+
+	Client &client = m_Clients.at(id);
+	if (client.Queue.empty())
+		client.VirtualTime = std::max(client.VirtualTime, m_VirtualTime);
+
+	client.Queue.push_back(ticket);
+	m_QueuedPositions += positions.size();
+
+	lock.unlock();
+	m_RequestQueued.notify_one();
+
+	return ticket;
+}
+
+bool SimulationBatcher::Collect(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc, bool wait)
+{
+	std::unique_lock lock(m_Mutex);
+
+	auto it = m_Requests.find(ticket);
+	assert(it != m_Requests.end());
+
+	Request &request = it->second;
+	if (wait)
+		m_RequestDone.wait(lock, [&] { return request.Done; });
+	else if (!request.Done)
+		return false;
+
+	assert(blackInc.size() >= request.Positions.size());
+
+	std::copy(request.BlackInc.begin(), request.BlackInc.end(), blackInc.begin());
+	std::copy(request.WhiteInc.begin(), request.WhiteInc.end(), whiteInc.begin());
+	std::copy(request.VisitsInc.begin(), request.VisitsInc.end(), visitsInc.begin());
+
+	m_Requests.erase(it);
+
+	return true;
+}
+
+SimulationBatcher::Client *SimulationBatcher::GetNextClient()
+{
+	Client *next = nullptr;
+	for (auto &[id, client] : m_Clients)
+	{
+		if (client.Queue.empty())
+			continue;
+
+		if (next == nullptr || client.Priority > next->Priority
+			|| (client.Priority == next->Priority && client.VirtualTime < next->VirtualTime))
+			next = &client;
+	}
+
+	return next;
+}
+
+std::chrono::steady_clock::time_point SimulationBatcher::GetOldestRequest() const
+{
+	std::chrono::steady_clock::time_point oldest = std::chrono::steady_clock::time_point::max();
+	for (const auto &[id, client] : m_Clients)
+		if (!client.Queue.empty())
+			oldest = std::min(oldest, m_Requests.at(client.Queue.front()).Queued);
+
+	return oldest;
+}
+
+void SimulationBatcher::DispatchLoop()
+{
+	Trace::SetThreadName("Simulation Batcher");
+
+	std::vector<SimulationTicket> tickets;
+
+	// Positions of every ticket in the batch, a removed client's positions still take up their place
+	std::vector<size_t> counts;
+	std::vector<Position> positions;
+	std::vector<int> blackInc, whiteInc, visitsInc;
+
+	std::unique_lock lock(m_Mutex);
+	while (true)
+	{
+		m_RequestQueued.wait(lock, [&] { return m_Stopping || GetNextClient() != nullptr; });
+
+		if (m_Stopping)
+			return;
+
+		// A partial batch waits for more requests until the oldest one runs out of time
+		const std::chrono::steady_clock::time_point deadline = GetOldestRequest() + m_MaxDelay;
+		m_RequestQueued.wait_until(lock, deadline, [&] { return m_Stopping || m_QueuedPositions >= m_BatchSize; });
+
+		if (m_Stopping)
+			return;
+
+		const std::chrono::steady_clock::time_point dispatched = std::chrono::steady_clock::now();
+
+		tickets.clear();
+		counts.clear();
+		positions.clear();
+		while (Client *client = GetNextClient())
+		{
+			Request &request = m_Requests[client->Queue.front()];
+			if (!positions.empty() && positions.size() + request.Positions.size() > m_BatchSize)
+				break;
+
+			positions.insert(positions.end(), request.Positions.begin(), request.Positions.end());
+			tickets.push_back(client->Queue.front());
+			counts.push_back(request.Positions.size());
+			client->Queue.pop_front();
+
+			client->Wait += dispatched - request.Queued;
+			m_VirtualTime = client->VirtualTime;
+			client->VirtualTime += request.Positions.size() / (double)client->Weight;
+		}
+		m_QueuedPositions -= positions.size();
+
+		if (tickets.empty())
+			continue;
+
+		lock.unlock();
+
+		blackInc.resize(positions.size());
+		whiteInc.resize(positions.size());
+		visitsInc.resize(positions.size());
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (!positions.empty())
+		{
+			Timer<"Batcher Simulation"> timer;
+			m_Simulator->Simulate(positions, blackInc, whiteInc, visitsInc);
+		}
+		const std::chrono::nanoseconds busy = std::chrono::steady_clock::now() - start;
+
+		lock.lock();
+
+		size_t offset = 0;
+		for (size_t i = 0; i < tickets.size(); i++)
+		{
+			const size_t count = counts[i];
+			auto it = m_Requests.find(tickets[i]);
+			offset += count;
+
+			// The client was removed during the simulation
+			if (it == m_Requests.end())
+				continue;
+
+			Request &request = it->second;
+			const size_t first = offset - count;
+
+			request.BlackInc.assign(blackInc.begin() + first, blackInc.begin() + offset);
+			request.WhiteInc.assign(whiteInc.begin() + first, whiteInc.begin() + offset);
+			request.VisitsInc.assign(visitsInc.begin() + first, visitsInc.begin() + offset);
+			request.Done = true;
+
+			auto client = m_Clients.find(request.Client);
+			if (client != m_Clients.end())
+			{
+				client->second.Requests++;
+				client->second.Positions += count;
+				if (!positions.empty())
+					client->second.Busy += busy * count / positions.size();
+			}
+		}
+
+		m_Batches++;
+		m_Positions += positions.size();
+		m_RequestCount += tickets.size();
+
+		m_RequestDone.notify_all();
+	}
+}
+
+BatchingSimulator::BatchingSimulator(SimulationBatcher &batcher, SimulationBatcher::ClientId client)
+	: m_Batcher(batcher), m_Client(client)
+{
+}
+
+BatchingSimulator::~BatchingSimulator()
+{
+	m_Batcher.RemoveClient(m_Client);
+}
+
+void BatchingSimulator::SetPriority(int priority)
+{
+	m_Batcher.SetPriority(m_Client, priority);
+}
+
+void BatchingSimulator::Cancel()
+{
+	m_Batcher.Cancel(m_Client);
+}
+
+void BatchingSimulator::Simulate(const std::vector<Position> &positions, std::vector<int> &blackInc, std::vector<int> &whiteInc, std::vector<int> &visitsInc)
+{
+	SimulationTicket ticket = Submit(positions);
+
+	Wait(ticket, std::span(blackInc).first(positions.size()), std::span(whiteInc).first(positions.size()), std::span(visitsInc).first(positions.size()));
+
+	std::fill(blackInc.begin() + positions.size(), blackInc.end(), 0);
+	std::fill(whiteInc.begin() + positions.size(), whiteInc.end(), 0);
+	std::fill(visitsInc.begin() + positions.size(), visitsInc.end(), 0);
+}
+
+SimulationTicket BatchingSimulator::Submit(std::span<const Position> positions)
+{
+	return m_Batcher.Enqueue(m_Client, positions);
+}
+
+bool BatchingSimulator::Poll(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc)
+{
+	return m_Batcher.Collect(ticket, blackInc, whiteInc, visitsInc, false);
+}
+
+void BatchingSimulator::Wait(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc)
+{
+	m_Batcher.Collect(ticket, blackInc, whiteInc, visitsInc, true);
+}
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Simulator.h"
+
+namespace Checkers
+{
+
+struct BatchingStats
+{
+	uint64_t Batches, Positions, Requests;
+
+	// Positions waiting for the next batch
+	size_t QueuedPositions;
+
+	// Average share of the batch size used by dispatched batches
+	double FillRatio;
+};
+
+struct BatchingClientStats
+{
+	std::string Name;
+	unsigned int Weight;
+	int Priority;
+
+	uint64_t Requests, Positions;
+
+	// Share of the wall time since the client was created that the simulator spent on its positions
+	double Utilization;
+	std::chrono::microseconds AverageWait;
+};
+
+// Combines the batches of many trees into single calls of one shared simulator
+// A batch is dispatched once batchSize positions are queued or the oldest request waited maxDelay
+// Clients of a higher priority go first, clients of the same priority get positions in proportion to their weights
+class SimulationBatcher
+{
+public:
+	SimulationBatcher(Simulator *simulator, size_t batchSize, std::chrono::microseconds maxDelay);
+	~SimulationBatcher();
+
+	SimulationBatcher(const SimulationBatcher &) = delete;
+	SimulationBatcher &operator=(const SimulationBatcher &) = delete;
+
+	// Simulator for one tree, all of them feed this batcher
+	Simulator *CreateClient(std::string name = {}, unsigned int weight = 1, int priority = 0);
+
+	size_t GetBatchSize() const { return m_BatchSize; }
+
+	BatchingStats GetStats() const;
+	std::vector<BatchingClientStats> GetClientStats() const;
+
+private:
+	friend class BatchingSimulator;
+
+	using ClientId = uint64_t;
+
+	struct Request
+	{
+		ClientId Client;
+
+		std::vector<Position> Positions = {};
+		std::vector<int> BlackInc = {}, WhiteInc = {}, VisitsInc = {};
+
+		std::chrono::steady_clock::time_point Queued;
+		bool Done = false;
+	};
+
+	struct Client
+	{
+		std::string Name;
+		unsigned int Weight;
+		int Priority;
+
+		// Requests are never split between batches
+		std::deque<SimulationTicket> Queue = {};
+
+		// Positions dispatched divided by the weight, the client with the lowest one goes next
+		double VirtualTime = 0.0;
+
+		uint64_t Requests = 0, Positions = 0;
+		std::chrono::nanoseconds Busy = {}, Wait = {};
+		std::chrono::steady_clock::time_point Created;
+	};
+
+	std::unique_ptr<Simulator> m_Simulator;
+	const size_t m_BatchSize;
+	const std::chrono::microseconds m_MaxDelay;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_RequestQueued;
+	std::condition_variable m_RequestDone;
+
+	std::unordered_map<ClientId, Client> m_Clients;
+	std::unordered_map<SimulationTicket, Request> m_Requests;
+	ClientId m_NextClient = 1;
+	SimulationTicket m_NextTicket = 1;
+	size_t m_QueuedPositions = 0;
+
+	// Virtual time of the last dispatched request, idle clients don't bank time below it
+	double m_VirtualTime = 0.0;
+
+	uint64_t m_Batches = 0, m_Positions = 0, m_RequestCount = 0;
+	bool m_Stopping = false;
+
+	std::thread m_Dispatcher;
+
+	void RemoveClient(ClientId client);
+	void Cancel(ClientId client);
+	void SetPriority(ClientId client, int priority);
+
+	SimulationTicket Enqueue(ClientId client, std::span<const Position> positions);
+	bool Collect(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc, bool wait);
+
+	Client *GetNextClient();
+	std::chrono::steady_clock::time_point GetOldestRequest() const;
+
+	void DispatchLoop();
+};
+
+// Asynchronous simulator of one tree, the simulation itself happens in the shared batcher
+class BatchingSimulator : public Simulator
+{
+public:
+	BatchingSimulator(SimulationBatcher &batcher, SimulationBatcher::ClientId client);
+	~BatchingSimulator() override;
+
+	// A pondering search can give way to the ones that are on the clock
+	void SetPriority(int priority);
+
+	void Simulate(const std::vector<Position> &positions, std::vector<int> &blackInc, std::vector<int> &whiteInc, std::vector<int> &visitsInc) override;
+
+	SimulationTicket Submit(std::span<const Position> positions) override;
+	bool Poll(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc) override;
+	void Wait(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc) override;
+
+	bool IsAsynchronous() const override { return true; }
+
+	// Queued requests complete right away, ones already dispatched complete with their batch
+	void Cancel() override;
+
+private:
+	SimulationBatcher &m_Batcher;
+	const SimulationBatcher::ClientId m_Client;
+};
+
+}
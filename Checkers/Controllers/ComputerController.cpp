@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <format>
+
+#include "Core/Telemetry.h"
+
 #include "ComputerController.h"
 
 namespace Checkers
@@ -9,16 +14,144 @@ void ComputerController::OnClick(float x, float y)
 
 Position ComputerController::MakeMove(Position position)
 {
-	m_Cancelled = false;
+	const std::stop_token stop = GetStop();
+
+	// Capture sequences that end in the same position are separate moves but the same choice
+	MoveGenerator::Generate(position, m_Moves);
+	const bool forced = std::all_of(m_Moves.begin(), m_Moves.end(), [&](const Move &move) {
+		return move.Position == m_Moves.front().Position;
+	});
+
+	m_TimeManager.Start(forced);
+	m_Tree.Begin(position, stop);
+
+	// Every move is searched until a root move has a visit, so that even an empty clock returns a legal move
+	// A forced move isn't searched further, the report and the reused subtree still stay consistent
+	bool visited = false;
+	while (m_Tree.Step())
+	{
+		if (!visited)
+			visited = !m_Tree.Snapshot().PrincipalVariation.empty();
+
+		if (visited && (forced || m_TimeManager.Update(m_Tree)))
+			break;
+	}
+
+	Position best = m_Tree.End();
+	m_TimeManager.Finish();
+
+	if (!stop.stop_requested())
+	{
+		const TimeStats &stats = m_TimeManager.GetGameStats();
+		const std::string color = position.BlackTurn ? "Black" : "White";
+		Stats::AddStat(std::format("{} Time Saved", color), "{} Time Saved: {:.2f} s of {:.2f} s ({} forced, {} early, {} extended)",
+			color, stats.Saved.count() / 1e9, (stats.Saved + stats.Used).count() / 1e9, stats.Forced, stats.StoppedEarly, stats.Extended
+		);
+	}
+
+	return FinishMove(stop.stop_requested() ? Position() : best, stop);
+}
+
+Position ComputerController::MakeMove(Position position, const SearchLimits &limits)
+{
+	const std::stop_token stop = GetStop();
+
+	return FinishMove(m_Tree.FindBestMove(position, stop, limits), stop);
+}
 
-	return m_Tree.FindBestMove(position, m_Cancelled);
+void ComputerController::PrepareMove()
+{
+	std::lock_guard lock(m_Mutex);
+	m_Stop = std::stop_source();
+}
+
+// A cancel that came before the move started is kept, so the move returns right away
+std::stop_token ComputerController::GetStop()
+{
+	std::lock_guard lock(m_Mutex);
+	return m_Stop.get_token();
+}
+
+Position ComputerController::FinishMove(Position best, const std::stop_token &stop)
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Stop = std::stop_source();
+	}
+
+	if (stop.stop_requested())
+	{
+		std::chrono::nanoseconds latency;
+		{
+			std::lock_guard lock(m_Mutex);
+			latency = std::chrono::steady_clock::now() - m_CancelRequested;
+		}
+
+		// From CancelMove to the return of the search
+		Timer<"Cancellation Latency">::Add(latency);
+		Stats::AddStat("Cancellation Latency", "Cancellation Latency: {:.3f} ms", latency.count() / 1e6);
+
+		return best;
+	}
+
+	if (Telemetry::IsEnabled())
+		Telemetry::Write(m_Tree.GetReport().ToJson());
+
+	return best;
+}
+
+void ComputerController::WarmUp()
+{
+	m_Tree.WarmUp();
+}
+
+SearchLimits ComputerController::GetDefaultLimits() const
+{
+	return m_Tree.GetDefaultLimits();
+}
+
+void ComputerController::SetSubtreeReuse(bool reuse)
+{
+	m_Tree.SetSubtreeReuse(reuse);
+}
+
+const SearchReport &ComputerController::GetReport() const
+{
+	return m_Tree.GetReport();
+}
+
+void ComputerController::SetExpansion(const ExpansionSettings &settings)
+{
+	m_Tree.SetExpansion(settings);
+}
+
+void ComputerController::SetCompactNodes(bool compact)
+{
+	m_Tree.SetCompactNodes(compact);
+}
+
+void ComputerController::SetReordering(size_t threshold)
+{
+	m_Tree.SetReordering(threshold);
+}
+
+void ComputerController::SetClock(const Clock &clock)
+{
+	m_TimeManager.SetClock(clock);
+}
+
+const TimeStats &ComputerController::GetTimeStats() const
+{
+	return m_TimeManager.GetGameStats();
 }
 
 void ComputerController::CancelMove()
 {
-	if (m_Cancelled) return;
+	std::lock_guard lock(m_Mutex);
+	if (m_Stop.stop_requested()) return;
 
-	m_Cancelled = true;
+	m_CancelRequested = std::chrono::steady_clock::now();
+	m_Stop.request_stop();
 }
 
 }
@@ -4,11 +4,16 @@
 #include <cassert>
 #include <chrono>
 #include <memory>
+#include <mutex>
+#include <stop_token>
 #include <thread>
+#include <vector>
 
 #include "Core/Core.h"
 #include "Controller.h"
 #include "MCTS.h"
+#include "MoveGenerator.h"
+#include "TimeManager.h"
 
 namespace Checkers
 {
@@ -17,19 +22,50 @@ class ComputerController : public Controller
 {
 public:
 	ComputerController(ControllerType type, Simulator *simulator, unsigned int iterationCount, std::chrono::milliseconds maxTime, unsigned int selectedCount = 1, float explorationConstant = Tree::DefaultExplorationConstant, float virtualLoss = 0.01f)
-		: Controller(type), m_Tree(simulator, iterationCount, maxTime, selectedCount, explorationConstant, virtualLoss)
+		: Controller(type), m_Tree(simulator, iterationCount, maxTime, selectedCount, explorationConstant, virtualLoss), m_TimeManager(maxTime)
+	{
+	}
+
+	// Owns the simulator, for controllers created per game session
+	ComputerController(ControllerType type, std::unique_ptr<Simulator> simulator, unsigned int iterationCount, std::chrono::milliseconds maxTime, unsigned int selectedCount = 1, float explorationConstant = Tree::DefaultExplorationConstant, float virtualLoss = 0.01f)
+		: Controller(type), m_OwnedSimulator(std::move(simulator)), m_Tree(m_OwnedSimulator.get(), iterationCount, maxTime, selectedCount, explorationConstant, virtualLoss), m_TimeManager(maxTime)
 	{
 	}
 	~ComputerController() override {}
 
 	void OnClick(float x, float y) override;
+
+	// The time manager splits the clock (or the time given in the constructor) between moves
 	Position MakeMove(Position position) override;
 	void CancelMove() override;
+	void PrepareMove() override;
+	void WarmUp() override;
+	void SetClock(const Clock &clock) override;
+
+	// Search with limits other than the ones given in the constructor (engine protocol), no time management
+	Position MakeMove(Position position, const SearchLimits &limits);
+
+	SearchLimits GetDefaultLimits() const;
+	void SetSubtreeReuse(bool reuse);
+	void SetExpansion(const ExpansionSettings &settings);
+	void SetCompactNodes(bool compact);
+	void SetReordering(size_t threshold);
+	const SearchReport &GetReport() const;
+	const TimeStats &GetTimeStats() const;
 
 private:
+	std::unique_ptr<Simulator> m_OwnedSimulator = nullptr;
 	Tree m_Tree;
+	TimeManager m_TimeManager;
+	std::vector<Move> m_Moves;
+
+	// Armed by PrepareMove and replaced after every move, CancelMove stops the current one
+	std::mutex m_Mutex;
+	std::stop_source m_Stop;
+	std::chrono::steady_clock::time_point m_CancelRequested = {};
 
-	bool m_Cancelled = false;
+	std::stop_token GetStop();
+	Position FinishMove(Position best, const std::stop_token &stop);
 };
 
 }
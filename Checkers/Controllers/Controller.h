@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+
 #include "Position.h"
 
 namespace Checkers
@@ -9,9 +12,29 @@ enum class ControllerType
 {
 	PlayerController,
 	ComputerHostController,
+	ComputerThreadedHostController,
 	ComputerDeviceController
 };
 
+// Clock of each side, a zero base means no clock
+struct TimeControl
+{
+	std::chrono::milliseconds Base = {}, Increment = {};
+
+	bool IsEnabled() const { return Base.count() > 0; }
+};
+
+// Time of the side to move, before its next move
+struct Clock
+{
+	// max without a clock
+	std::chrono::nanoseconds Remaining = std::chrono::nanoseconds::max();
+	std::chrono::nanoseconds Increment = {};
+
+	// Moves the side already made in this game
+	size_t MoveNumber = 0;
+};
+
 class Controller
 {
 public:
@@ -33,6 +56,16 @@ public:
 	// MakeMove should return soon after call to this
 	virtual void CancelMove() = 0;
 
+	// Before the controller is published to CancelMove for its next move (Game thread)
+	// A cancel from then on stops that move, even if it arrives before MakeMove starts
+	virtual void PrepareMove() {}
+
+	// Blocking, prepares for the first move (background thread, before the first MakeMove)
+	virtual void WarmUp() {}
+
+	// Before every MakeMove of a game session, Remaining is max when the game has no clock (Game thread)
+	virtual void SetClock(const Clock &clock) {}
+
 private:
 	const ControllerType m_Type;
 };
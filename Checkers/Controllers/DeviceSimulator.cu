@@ -108,7 +108,7 @@ void DeviceSimulator::Simulate(const std::vector<Position> &positions, std::vect
 	cudaMemcpy(m_dPositions, positions.data(), sizeof(Position) * blockCount, cudaMemcpyHostToDevice);
 
 	{
-		Timer timer("Kernel");
+		Timer<"Kernel"> timer;
 		SimulateKernel<<<blockCount, m_ThreadsPerBlock>>>(m_dPositions, m_Generators, m_dBlackInc, m_dWhiteInc);
 		cudaDeviceSynchronize();
 	}
@@ -122,4 +122,9 @@ void DeviceSimulator::Simulate(const std::vector<Position> &positions, std::vect
 	std::fill(visitsInc.begin() + blockCount, visitsInc.end(), 0);
 }
 
+Simulator *Simulator::CreateDevice(unsigned int blockCount, unsigned int threadsPerBlock)
+{
+	return new DeviceSimulator(blockCount, threadsPerBlock);
+}
+
 }
@@ -30,9 +30,13 @@ void HostSimulator::Simulate(const std::vector<Position> &positions, std::vector
 	std::fill(whiteInc.begin(), whiteInc.end(), 0);
 	std::fill(visitsInc.begin(), visitsInc.end(), 0);
 
-	Position position = positions[0];
-	position.SimulateOne(m_Generator, blackInc[0], whiteInc[0]);
-	visitsInc[0] = 2;
+	// One playout of every position, in a batch merged from several searches each of them is a different leaf
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		Position position = positions[i];
+		m_PlyCount += position.SimulateOne(m_Generator, blackInc[i], whiteInc[i]);
+		visitsInc[i] = 2;
+	}
 }
 
 }
\ No newline at end of file
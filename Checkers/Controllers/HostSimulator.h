@@ -26,8 +26,11 @@ public:
 
 	void Simulate(const std::vector<Position> &positions, std::vector<int> &blackInc, std::vector<int> &whiteInc, std::vector<int> &visitsInc) override;
 
+	uint64_t GetPlyCount() const override { return m_PlyCount; }
+
 private:
 	HostGenerator m_Generator;
+	uint64_t m_PlyCount = 0;
 };
 
 }
@@ -1,5 +1,9 @@
+#include <algorithm>
+#include <bit>
+#include <cfloat>
 #include <cmath>
 #include <iostream>
+#include <numeric>
 
 #include "Core/Core.h"
 
@@ -9,84 +13,496 @@ namespace Checkers
 {
 
 Tree::Tree(Simulator *simulator, unsigned int maxIterations, std::chrono::milliseconds maxTime, unsigned int selectCount, float explorationConstant, float virtualLoss)
-	: m_Simulator(simulator), m_MaxIterations(maxIterations),
-	m_ExplorationContant(explorationConstant), m_MaxSelectedCount(selectCount),
-	m_VirtualLossIncrement(virtualLoss), m_MaxTime(maxTime - std::chrono::milliseconds(1))
+	: m_Simulator(simulator), m_MaxIterations(maxIterations), m_MaxTime(maxTime - std::chrono::milliseconds(1)),
+	m_ExplorationContant(explorationConstant), m_MaxSelectedCount(selectCount), m_VirtualLossIncrement(virtualLoss)
 {
-	m_Nodes.reserve(StartNodeCount);
-	m_VirtualLoss.reserve(StartNodeCount);
+	SetExpansion(m_Expansion);
 }
 
 Tree::~Tree()
 {
 }
 
-Position Tree::FindBestMove(Position position, const int &cancelled)
+Position Tree::FindBestMove(Position position, std::stop_token stop)
+{
+	return FindBestMove(position, stop, GetDefaultLimits());
+}
+
+SearchLimits Tree::GetDefaultLimits() const
+{
+	return SearchLimits{
+		.Time = m_MaxTime
+	};
+}
+
+void Tree::SetSubtreeReuse(bool reuse)
+{
+	m_SubtreeReuse = reuse;
+}
+
+void Tree::SetExpansion(const ExpansionSettings &settings)
 {
-	Timer timer("MCTS Total");
+	m_Expansion = settings;
+
+	// Inverse of Base * n^Exponent, so that selection compares visits instead of raising them to a power
+	for (uint32_t children = 0; children <= UINT8_MAX; children++)
+	{
+		const double simulations = std::ceil(std::pow(children / (double)settings.WideningBase, 1.0 / settings.WideningExponent));
+		m_WideningSimulations[children] = children <= 1 || !IsWidening() ? 0 : (uint32_t)std::min(simulations, (double)UINT32_MAX);
+	}
 
 	m_Nodes.clear();
 	m_VirtualLoss.clear();
-	m_Nodes.emplace_back(Node{
-		.Position = position
-	});
-	m_VirtualLoss.emplace_back(0.0f);
+	m_Expansions.clear();
+	m_Positions.clear();
+}
+
+bool Tree::IsWidening() const
+{
+	return m_Expansion.WideningBase > 0.0f;
+}
 
-	std::chrono::time_point start(std::chrono::high_resolution_clock::now());
-	for (int i = 0; i < m_MaxIterations; i++)
+void Tree::SetCompactNodes(bool compact)
+{
+	m_CompactNodes = compact;
+
+	// The next search can't reuse a tree in the other format
+	m_Nodes.clear();
+	m_VirtualLoss.clear();
+	m_Expansions.clear();
+	m_Positions.clear();
+	if (compact)
+		m_Positions.shrink_to_fit();
+}
+
+void Tree::SetReordering(size_t threshold)
+{
+	m_ReorderThreshold = threshold;
+}
+
+void Tree::Reserve()
+{
+	if (m_Nodes.capacity() >= StartNodeCount && (m_CompactNodes || m_Positions.capacity() >= StartNodeCount))
+		return;
+
+	Timer<"MCTS Reserve"> timer;
+	m_Nodes.reserve(StartNodeCount);
+	m_VirtualLoss.reserve(StartNodeCount);
+	m_Expansions.reserve(StartNodeCount);
+	if (!m_CompactNodes)
+		m_Positions.reserve(StartNodeCount);
+}
+
+void Tree::WarmUp()
+{
+	Reserve();
+
+	// Touches the arena so that its pages are mapped before the first search
+	if (m_Nodes.empty())
 	{
-		if (cancelled)
+		m_Nodes.resize(m_Nodes.capacity());
+		m_VirtualLoss.resize(m_VirtualLoss.capacity());
+		m_Expansions.resize(m_Expansions.capacity());
+		m_Positions.resize(m_Positions.capacity());
+		m_Nodes.clear();
+		m_VirtualLoss.clear();
+		m_Expansions.clear();
+		m_Positions.clear();
+	}
+
+	std::vector<Position> positions(1, StartingPosition);
+	std::vector<int> blackInc(1), whiteInc(1), visitsInc(1);
+	m_Simulator->Simulate(positions, blackInc, whiteInc, visitsInc);
+}
+
+Position Tree::FindBestMove(Position position, std::stop_token stop, const SearchLimits &limits)
+{
+	Timer<"MCTS Total"> timer;
+
+	Begin(position, stop);
+
+	std::chrono::time_point lastInfo = m_Start;
+	for (unsigned int i = 0; i < m_MaxIterations; i++)
+	{
+		if (stop.stop_requested())
+		{
+			Finish();
 			return Position();
+		}
 
 		std::chrono::time_point now(std::chrono::high_resolution_clock::now());
 
-		if (now - start > m_MaxTime)
+		if (now - m_Start > limits.Time)
+			break;
+
+		if (limits.Stop != nullptr && limits.Stop->load(std::memory_order_relaxed))
+			break;
+
+		if (limits.Simulations != 0 && m_Nodes[0].Visits / 2 - m_ReusedSimulations >= limits.Simulations)
+			break;
+
+		if (limits.Nodes != 0 && m_Nodes.size() - m_ReusedNodes >= limits.Nodes)
 			break;
 
-		m_Paths.clear();
-		m_Selected.clear();
+		if (limits.MaxNodes != 0 && m_Nodes.size() >= limits.MaxNodes)
+			break;
 
-		int pathCount = 0;
-		while (m_Selected.size() < m_MaxSelectedCount)
+		if (limits.OnInfo && now - lastInfo >= limits.InfoInterval)
 		{
-			node_index index;
-			{
-				Timer timer("MCTS Selection");
-				index = SelectNode();
-			}
+			FillReport(now - m_Start, m_PhasesBefore);
+			limits.OnInfo(m_Report);
+			lastInfo = now;
+		}
 
-			if (index == 0 && m_Nodes[0].Child != 0)
-				break;
+		Iterate();
+	}
 
-			{
-				Timer timer("MCTS Expansion");
-				Expand(index);
-			}
+	return End();
+}
+
+void Tree::Begin(Position position, std::stop_token stop)
+{
+	Reserve();
+
+	m_PhasesBefore = Instrumentation::Snapshot();
+	m_MaxDepth = 0;
+	m_DepthSum = 0;
+	m_DepthCount = 0;
+	m_DuplicateCaptures = 0;
+
+	if (!m_SubtreeReuse || !ReuseSubtree(position))
+	{
+		m_Nodes.clear();
+		m_VirtualLoss.clear();
+		m_Expansions.clear();
+		m_Positions.clear();
+		m_Nodes.emplace_back(Node{});
+		m_VirtualLoss.emplace_back(0.0f);
+		m_Expansions.emplace_back(Expansion{});
+		if (!m_CompactNodes)
+			m_Positions.emplace_back(position);
+	}
+	m_Root = position;
+	m_ReusedSimulations = m_Nodes[0].Visits / 2;
+
+	// A reused root may have been widened partially, the root has all moves so that the report lists them
+	if (m_Nodes[0].Child != 0)
+		AddChildNodes(0, m_Root, m_Expansions[0].Total - m_Expansions[0].Generated);
+	m_ReusedNodes = m_Nodes.size();
+
+	m_Current = &m_Batches[0];
+	m_Next = &m_Batches[1];
+	m_Iterations = 0;
+	m_NextReorder = m_ReorderThreshold;
+	m_Start = std::chrono::high_resolution_clock::now();
+
+	// Runs on the thread requesting the stop, the simulator cuts the batches in flight short
+	m_Stop = stop;
+	m_OnStop.reset();
+	m_OnStop.emplace(m_Stop, CancelSimulator{ m_Simulator });
+}
+
+bool Tree::Step(unsigned int iterations)
+{
+	for (unsigned int i = 0; i < iterations && m_Iterations < m_MaxIterations && !m_Stop.stop_requested(); i++)
+		Iterate();
+
+	return m_Iterations < m_MaxIterations && !m_Stop.stop_requested();
+}
+
+SearchSnapshot Tree::Snapshot() const
+{
+	const node_index best = GetBestChild();
+
+	uint32_t runnerUp = 0;
+	for (node_index childIndex = m_Nodes[0].Child; childIndex != 0; childIndex = m_Nodes[childIndex].Next)
+		if (childIndex != best)
+			runnerUp = std::max(runnerUp, m_Nodes[childIndex].Visits);
+
+	std::vector<Position> buffer;
+	SearchSnapshot snapshot = {
+		.BestMove = best == 0 ? m_Root : GetChildPosition(m_Root, best, buffer),
+		.Simulations = m_Nodes[0].Visits / 2,
+		.ReusedSimulations = m_ReusedSimulations,
+		.NodeCount = m_Nodes.size(),
+		.Time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - m_Start),
+		.RunnerUpVisits = runnerUp
+	};
+
+	GetPrincipalVariation(snapshot.PrincipalVariation);
+	return snapshot;
+}
+
+Position Tree::End()
+{
+	Finish();
+	FillReport(std::chrono::high_resolution_clock::now() - m_Start, m_PhasesBefore);
+
+	return GetBestMove();
+}
+
+void Tree::Iterate()
+{
+	if (m_Stop.stop_requested())
+		return;
+
+	m_Iterations++;
+
+	if (m_ReorderThreshold != 0 && m_Nodes.size() >= m_NextReorder)
+	{
+		Timer<"MCTS Reorder"> timer;
+		Reorder(0);
+		m_NextReorder = 2 * m_Nodes.size();
+	}
+
+	SelectBatch(*m_Next, m_Current->InFlight ? m_Current : nullptr);
 
-			for (int j = pathCount; j < m_Paths.size(); j++)
-				for (node_index index : m_Paths[j])
-					m_VirtualLoss[index] += m_VirtualLossIncrement;
+	// Not worth simulating anymore, backpropagating no visits removes its virtual loss
+	if (m_Stop.stop_requested())
+	{
+		std::fill(m_Next->BlackInc.begin(), m_Next->BlackInc.end(), 0);
+		std::fill(m_Next->WhiteInc.begin(), m_Next->WhiteInc.end(), 0);
+		std::fill(m_Next->VisitsInc.begin(), m_Next->VisitsInc.end(), 0);
+		BackPropagate(*m_Next);
+		return;
+	}
+
+	// Pipelining: batch k is simulated while batch k + 1 is selected under the virtual loss of batch k
+	if (!m_Simulator->IsAsynchronous())
+	{
+		{
+			Timer<"MCTS Simulation"> timer;
+			m_Simulator->Simulate(m_Next->Selected, m_Next->BlackInc, m_Next->WhiteInc, m_Next->VisitsInc);
+		}
+
+		{
+			Timer<"MCTS BackPropagation"> timer;
+			BackPropagate(*m_Next);
+		}
+
+		return;
+	}
+
+	if (m_Current->InFlight)
+		CompleteBatch(*m_Current);
+
+	SubmitBatch(*m_Next);
+	std::swap(m_Current, m_Next);
+
+	// A stop requested before the submit didn't see this batch
+	if (m_Stop.stop_requested())
+		m_Simulator->Cancel();
+}
+
+void Tree::Finish()
+{
+	if (m_Current->InFlight)
+		CompleteBatch(*m_Current);
+
+	m_OnStop.reset();
+}
+
+const SearchReport &Tree::GetReport() const
+{
+	return m_Report;
+}
+
+node_index Tree::FindDescendant(node_index index, const Position &nodePosition, const Position &position, int depth)
+{
+	if (nodePosition == position)
+		return index;
+
+	if (depth == MaxReuseDepth)
+		return 0;
+
+	for (node_index childIndex = m_Nodes[index].Child; childIndex != 0; childIndex = m_Nodes[childIndex].Next)
+	{
+		node_index found = FindDescendant(childIndex, GetChildPosition(nodePosition, childIndex, m_ChildBuffer), position, depth + 1);
+		if (found != 0)
+			return found;
+	}
+
+	return 0;
+}
+
+bool Tree::ReuseSubtree(const Position &position)
+{
+	if (m_Nodes.empty())
+		return false;
+
+	node_index root = 0;
+	if (m_Root != position)
+	{
+		root = FindDescendant(0, m_Root, position, 0);
+		if (root == 0)
+			return false;
+	}
+
+	Timer<"MCTS Subtree Reuse"> timer;
+
+	Reorder(root);
+	m_VirtualLoss.assign(m_Nodes.size(), 0.0f);
+
+	return true;
+}
+
+void Tree::Reorder(node_index root)
+{
+	ArenaVector<Node> nodes;
+	ArenaVector<float> virtualLoss;
+	ArenaVector<Expansion> expansions;
+	ArenaVector<Position> positions;
+	nodes.reserve(m_Nodes.capacity());
+	virtualLoss.reserve(m_VirtualLoss.capacity());
+	expansions.reserve(m_Expansions.capacity());
+	positions.reserve(m_Positions.capacity());
+
+	// New index of every old node, for the paths of a batch in flight
+	std::vector<node_index> remap(m_Nodes.size(), 0);
+
+	auto copy = [&](node_index old) {
+		remap[old] = nodes.size();
+		nodes.push_back(m_Nodes[old]);
+		virtualLoss.push_back(m_VirtualLoss[old]);
+		expansions.push_back(m_Expansions[old]);
+		if (!m_CompactNodes)
+			positions.push_back(m_Positions[old]);
+	};
+
+	copy(root);
+	nodes[0].Next = 0;
+	expansions[0].Move = 0;
+
+	// Nodes whose children aren't copied yet, the most visited child is taken first
+	std::vector<node_index> stack(1, 0);
+	node_index group[UINT8_MAX + 1];
+	while (!stack.empty())
+	{
+		const node_index index = stack.back();
+		stack.pop_back();
+
+		const node_index oldChild = nodes[index].Child;
+		if (oldChild == 0)
+			continue;
 
-			pathCount = m_Paths.size();
+		const node_index first = nodes.size();
+		for (node_index childIndex = oldChild; childIndex != 0; childIndex = m_Nodes[childIndex].Next)
+		{
+			copy(childIndex);
+			nodes.back().Next = nodes.size();
 		}
+		nodes.back().Next = 0;
+		nodes[index].Child = first;
+
+		const node_index count = nodes.size() - first;
+		std::iota(group, group + count, first);
+		std::sort(group, group + count, [&](node_index a, node_index b) { return nodes[a].Visits < nodes[b].Visits; });
+		stack.insert(stack.end(), group, group + count);
+	}
+
+	if (m_Current->InFlight)
+		for (std::vector<node_index> &path : m_Current->Paths)
+			for (node_index &index : path)
+				index = remap[index];
+
+	m_Nodes.swap(nodes);
+	m_VirtualLoss.swap(virtualLoss);
+	m_Expansions.swap(expansions);
+	m_Positions.swap(positions);
+}
 
-		std::vector<int> blackInc(m_Paths.size()), whiteInc(m_Paths.size()), visitsInc(m_Paths.size());
+void Tree::SelectBatch(Batch &batch, Batch *inFlight)
+{
+	batch.Paths.clear();
+	batch.Selected.clear();
+
+	size_t pathCount = 0;
+	while (batch.Selected.size() < m_MaxSelectedCount)
+	{
+		if (!batch.Selected.empty() && m_Stop.stop_requested())
+			break;
 
+		node_index index;
+		Position position;
 		{
-			Timer timer("MCTS Simulation");
-			m_Simulator->Simulate(m_Selected, blackInc, whiteInc, visitsInc);
+			Timer<"MCTS Selection"> timer;
+			index = SelectNode(batch, position);
 		}
 
+		if (index == 0 && m_Nodes[0].Child != 0)
+			break;
+
 		{
-			Timer timer("MCTS BackPropagation");
-			BackPropagate(blackInc, whiteInc, visitsInc);
+			Timer<"MCTS Expansion"> timer;
+			Expand(batch, index, position);
 		}
+
+		for (size_t j = pathCount; j < batch.Paths.size(); j++)
+			for (node_index index : batch.Paths[j])
+				m_VirtualLoss[index] += m_VirtualLossIncrement;
+
+		pathCount = batch.Paths.size();
+
+		if (inFlight != nullptr)
+			PollBatch(*inFlight);
 	}
 
-	return GetBestMove();
+	batch.BlackInc.resize(batch.Paths.size());
+	batch.WhiteInc.resize(batch.Paths.size());
+	batch.VisitsInc.resize(batch.Paths.size());
 }
 
-Position Tree::GetBestMove()
+void Tree::SubmitBatch(Batch &batch)
+{
+	batch.Ticket = m_Simulator->Submit(batch.Selected);
+	batch.SubmittedTicks = Instrumentation::GetTicks();
+	batch.InFlight = true;
+	batch.Ready = false;
+}
+
+void Tree::PollBatch(Batch &batch)
+{
+	if (batch.Ready)
+		return;
+
+	if (m_Simulator->Poll(batch.Ticket, batch.BlackInc, batch.WhiteInc, batch.VisitsInc))
+	{
+		batch.Ready = true;
+		batch.CompletedTicks = Instrumentation::GetTicks();
+	}
+}
+
+void Tree::CompleteBatch(Batch &batch)
+{
+	uint64_t waitedTicks = 0;
+	if (!batch.Ready)
+	{
+		const uint64_t start = Instrumentation::GetTicks();
+		m_Simulator->Wait(batch.Ticket, batch.BlackInc, batch.WhiteInc, batch.VisitsInc);
+		batch.CompletedTicks = Instrumentation::GetTicks();
+
+		waitedTicks = batch.CompletedTicks - start;
+	}
+
+#ifdef CHECKERS_ENABLE_TRACING
+	if (Trace::IsEnabled())
+		Trace::AddAsyncEvent("MCTS Simulation", batch.Ticket, batch.SubmittedTicks, batch.CompletedTicks);
+#endif
+
+	// Overlap is the part of the simulation during which the tree kept selecting the next batch
+	const std::chrono::nanoseconds simulated(Instrumentation::TicksToNanoseconds(batch.CompletedTicks - batch.SubmittedTicks));
+	const std::chrono::nanoseconds waited(Instrumentation::TicksToNanoseconds(waitedTicks));
+	Timer<"MCTS Simulation">::Add(simulated);
+	Timer<"MCTS Simulation Wait">::Add(waited);
+	Timer<"MCTS Overlap">::Add(simulated - waited);
+
+	batch.InFlight = false;
+
+	Timer<"MCTS BackPropagation"> timer;
+	BackPropagate(batch);
+}
+
+node_index Tree::GetBestChild() const
 {
 	uint32_t maxVisits = 0;
 	node_index maxIndex = 0;
@@ -97,12 +513,135 @@ Position Tree::GetBestMove()
 			maxIndex = childIndex;
 		}
 
-	const std::string color = m_Nodes[0].Position.BlackTurn ? "Black" : "White";
+	return maxIndex;
+}
+
+Position Tree::GetBestMove()
+{
+	const node_index maxIndex = GetBestChild();
+
+	const std::string color = m_Root.BlackTurn ? "Black" : "White";
 	Stats::AddStat(std::format("{} NodeCount", color), "{} Node Count: {} / {}", color, m_Nodes.size(), m_Nodes.capacity());
 	Stats::AddStat(std::format("{} Simulations", color), "{} Total Simulations: {:.3e}", color, m_Nodes[0].Visits / 2.0f);
 	Stats::AddStat(std::format("{} Winrate", color), "{} Win Rate: {:.3f} %%", color, (m_Nodes[maxIndex].Wins / (float)m_Nodes[maxIndex].Visits) * 100);
+	Stats::AddStat(std::format("{} Duplicate Captures", color), "{} Duplicate Captures: {}", color, m_DuplicateCaptures);
+
+	return maxIndex == 0 ? m_Root : GetChildPosition(m_Root, maxIndex, m_ChildBuffer);
+}
+
+static SearchMove GetSearchMove(const Position &parent, const Position &position, const Node &child)
+{
+	// The only piece of the side to move that changed squares
+	const Bitboard before = parent.GetCheckers();
+	const Bitboard after = parent.BlackTurn ? position.Black : position.White;
+
+	const Bitboard from = before & ~after;
+	const Bitboard to = after & ~before;
+
+	return SearchMove{
+		.From = from ? std::countr_zero(from) : -1,
+		.To = to ? std::countr_zero(to) : -1,
+		.Visits = child.Visits,
+		.Wins = child.Wins
+	};
+}
+
+void Tree::GetPrincipalVariation(std::vector<SearchMove> &moves) const
+{
+	moves.clear();
+
+	std::vector<Position> buffer;
+	Position position = m_Root;
+	for (node_index index = 0; m_Nodes[index].Child != 0;)
+	{
+		node_index best = m_Nodes[index].Child;
+		for (node_index childIndex = best; childIndex != 0; childIndex = m_Nodes[childIndex].Next)
+			if (m_Nodes[childIndex].Visits > m_Nodes[best].Visits)
+				best = childIndex;
 
-	return m_Nodes[maxIndex].Position;
+		if (m_Nodes[best].Visits == 0)
+			break;
+
+		const Position next = GetChildPosition(position, best, buffer);
+		moves.push_back(GetSearchMove(position, next, m_Nodes[best]));
+		position = next;
+		index = best;
+	}
+}
+
+void Tree::FillReport(std::chrono::nanoseconds time, const std::vector<InstrumentValue> &phasesBefore)
+{
+	const Node &root = m_Nodes[0];
+
+	m_Report.Root = m_Root;
+	m_Report.NodeCount = m_Nodes.size();
+	m_Report.NodeCapacity = m_Nodes.capacity();
+	m_Report.ArenaBytes = m_Nodes.size() * sizeof(Node) + m_VirtualLoss.size() * sizeof(float)
+		+ m_Expansions.size() * sizeof(Expansion) + m_Positions.size() * sizeof(Position);
+	m_Report.ArenaCapacityBytes = m_Nodes.capacity() * sizeof(Node) + m_VirtualLoss.capacity() * sizeof(float)
+		+ m_Expansions.capacity() * sizeof(Expansion) + m_Positions.capacity() * sizeof(Position);
+	m_Report.Simulations = root.Visits / 2;
+	m_Report.ReusedSimulations = m_ReusedSimulations;
+	m_Report.Time = std::chrono::duration_cast<std::chrono::microseconds>(time);
+	m_Report.MaxDepth = m_MaxDepth;
+	m_Report.AverageDepth = m_DepthCount == 0 ? 0.0f : m_DepthSum / (float)m_DepthCount;
+	m_Report.DuplicateCaptures = m_DuplicateCaptures;
+
+	m_Report.RootMoves.clear();
+	for (node_index childIndex = root.Child; childIndex != 0; childIndex = m_Nodes[childIndex].Next)
+		m_Report.RootMoves.push_back(GetSearchMove(m_Root, GetChildPosition(m_Root, childIndex, m_ChildBuffer), m_Nodes[childIndex]));
+
+	GetPrincipalVariation(m_Report.PrincipalVariation);
+
+	m_Report.Phases.clear();
+	for (const InstrumentValue &value : Instrumentation::Snapshot())
+	{
+		auto before = std::find_if(phasesBefore.begin(), phasesBefore.end(), [&](const InstrumentValue &previous) {
+			return previous.Name == value.Name && previous.Kind == value.Kind;
+		});
+
+		InstrumentValue delta = value;
+		if (before != phasesBefore.end())
+		{
+			delta.Ticks -= before->Ticks;
+			delta.Count -= before->Count;
+		}
+		delta.Value = value.Kind == InstrumentKind::Timer ? Instrumentation::TicksToNanoseconds(delta.Ticks) : delta.Ticks;
+
+		if (value.Kind == InstrumentKind::Timer && delta.Count != 0)
+			m_Report.Phases.push_back(delta);
+	}
+}
+
+double SearchReport::GetSimulationsPerSecond() const
+{
+	return Time.count() == 0 ? 0.0 : (Simulations - ReusedSimulations) / (Time.count() / 1e6);
+}
+
+std::string SearchReport::ToJson() const
+{
+	auto movesToJson = [](const std::vector<SearchMove> &moves) {
+		std::string json = "[";
+		for (size_t i = 0; i < moves.size(); i++)
+			json += std::format("{}{{\"from\":{},\"to\":{},\"visits\":{},\"wins\":{}}}",
+				i == 0 ? "" : ",", moves[i].From, moves[i].To, moves[i].Visits, moves[i].Wins
+			);
+		return json + "]";
+	};
+
+	std::string phases = "{";
+	for (size_t i = 0; i < Phases.size(); i++)
+		phases += std::format("{}\"{}\":{:.3f}", i == 0 ? "" : ",", Phases[i].Name, Phases[i].Value / 1e6);
+	phases += "}";
+
+	return std::format(
+		"{{\"side\":\"{}\",\"black\":{},\"white\":{},\"queens\":{},\"nodes\":{},\"simulations\":{},\"reused_simulations\":{},\"sims_per_sec\":{:.1f},"
+		"\"max_depth\":{},\"avg_depth\":{:.2f},\"duplicate_captures\":{},\"time_ms\":{:.3f},\"arena_bytes\":{},\"arena_capacity_bytes\":{},"
+		"\"root_moves\":{},\"pv\":{},\"phases_ms\":{}}}",
+		Root.BlackTurn ? "black" : "white", Root.Black, Root.White, Root.Queens, NodeCount, Simulations, ReusedSimulations,
+		GetSimulationsPerSecond(), MaxDepth, AverageDepth, DuplicateCaptures, Time.count() / 1e3,
+		ArenaBytes, ArenaCapacityBytes, movesToJson(RootMoves), movesToJson(PrincipalVariation), phases
+	);
 }
 
 float Tree::GetNodeScore(node_index index)
@@ -117,7 +656,12 @@ float Tree::GetNodeScore(node_index index)
 	return score;
 }
 
-void Tree::Print(node_index idx, node_index par, int h, int maxh)
+void Tree::Print(int maxh)
+{
+	Print(0, -1, m_Root, 0, maxh);
+}
+
+void Tree::Print(node_index idx, node_index par, const Position &position, int h, int maxh)
 {
 	const Node &node = m_Nodes[idx];
 
@@ -128,27 +672,167 @@ void Tree::Print(node_index idx, node_index par, int h, int maxh)
 	float score = winrate + m_ExplorationContant * std::sqrt(std::log(totalVisits) / visits);
 
 	std::cout << "par: " << par << ", idx: " << idx << ", next: " << m_Nodes[idx].Next
-		<< ", child: " << m_Nodes[idx].Child << std::hex << ", pos: " << node.Position.Black << " "
-		<< node.Position.White << std::dec << " (" << node.Wins << ", " << node.Visits << ")"
+		<< ", child: " << m_Nodes[idx].Child << std::hex << ", pos: " << position.Black << " "
+		<< position.White << std::dec << " (" << node.Wins << ", " << node.Visits << ")"
 		<< "wr: " << winrate << " score: " << score << std::endl;
 
 	if (h == maxh) return;
 
+	std::vector<Position> buffer;
 	for (node_index childIndex = node.Child; childIndex != 0; childIndex = m_Nodes[childIndex].Next)
-		Print(childIndex, idx, h + 1, maxh);
+		Print(childIndex, idx, GetChildPosition(position, childIndex, buffer), h + 1, maxh);
+}
+
+static void AddCaptures(int fromIndex, Position position, std::vector<Position> &children)
+{
+	Bitboard captures = position.GetCaptures(Board::FromIndex(fromIndex));
+
+	if (Board::IsEmpty(captures))
+	{
+		position.EndTurn();
+		children.push_back(position);
+
+		return;
+	}
+
+	int choices[8];
+	int choiceCnt = Board::GetBits(captures, choices);
+
+	for (int choiceIdx = 0; choiceIdx < choiceCnt; choiceIdx++)
+	{
+		int toIndex = choices[choiceIdx];
+		Position next = position;
+		next.Capture(fromIndex, toIndex);
+
+		AddCaptures(toIndex, next, children);
+	}
+}
+
+// Open addressing, slots hold index + 1 of a kept position, at most half full
+template<typename Slot>
+static size_t KeepFirstOccurrences(std::vector<Position> &positions, Slot *slots, uint32_t mask)
+{
+	std::fill_n(slots, mask + 1, 0);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		const Position &position = positions[i];
+
+		uint32_t hash = position.Black * 0x9E3779B1u ^ position.White * 0x85EBCA77u ^ position.Queens * 0xC2B2AE3Du;
+		hash ^= hash >> 16;
+
+		uint32_t slot = hash & mask;
+		while (slots[slot] != 0 && positions[slots[slot] - 1] != position)
+			slot = (slot + 1) & mask;
+
+		if (slots[slot] != 0)
+			continue;
+
+		positions[kept] = position;
+		slots[slot] = (Slot)(kept + 1);
+		kept++;
+	}
+
+	return kept;
+}
+
+// Different jump orders of a queen (or a man passing the same squares) can capture the same pieces and end on the same square
+// Keeps the first occurrence, so the children stay in the order of the MoveGenerator with its duplicates skipped
+static uint32_t RemoveDuplicates(std::vector<Position> &positions)
+{
+	if (positions.size() <= 1)
+		return 0;
+
+	const uint32_t mask = std::bit_ceil<uint32_t>(2 * (uint32_t)positions.size()) - 1;
+
+	size_t kept;
+	if (positions.size() <= UINT8_MAX)
+	{
+		uint8_t slots[2 * (UINT8_MAX + 1)];
+		kept = KeepFirstOccurrences(positions, slots, mask);
+	}
+	else
+	{
+		// Only long queen captures have this many sequences
+		std::vector<uint32_t> slots(mask + 1);
+		kept = KeepFirstOccurrences(positions, slots.data(), mask);
+	}
+
+	const uint32_t duplicates = (uint32_t)(positions.size() - kept);
+	positions.resize(kept);
+
+	return duplicates;
+}
+
+static uint32_t GenerateChildren(const Position &position, std::vector<Position> &children)
+{
+	children.clear();
+
+	Bitboard capturing = position.GetAllCapturing();
+
+	if (capturing)
+	{
+		int choices[12];
+		int choiceCnt = Board::GetBits(capturing, choices);
+
+		for (int choiceIdx = 0; choiceIdx < choiceCnt; choiceIdx++)
+			AddCaptures(choices[choiceIdx], position, children);
+
+		return RemoveDuplicates(children);
+	}
+
+	Bitboard moving = position.GetAllMoving();
+	assert(!Board::IsEmpty(moving));
+
+	int fromChoices[12];
+	int fromChoiceCount = Board::GetBits(moving, fromChoices);
+	for (int i = 0; i < fromChoiceCount; i++)
+	{
+		const int fromIndex = fromChoices[i];
+
+		Bitboard moves = position.GetMoves(Board::FromIndex(fromIndex));
+		assert(!Board::IsEmpty(moves));
+
+		int toChoices[16];
+		int toChoiceCount = Board::GetBits(moves, toChoices);
+		for (int j = 0; j < toChoiceCount; j++)
+		{
+			const int toIndex = toChoices[j];
+
+			Position next = position;
+		
+			next.Move(fromIndex, toIndex);
+			next.EndTurn();
+
+			children.push_back(next);
+		}
+	}
+
+	// Simple moves of different pieces or to different squares never end in the same position
+	return 0;
 }
 
-node_index Tree::SelectNode()
+node_index Tree::SelectNode(Batch &batch, Position &position)
 {
-	m_Paths.push_back({});
+	batch.Paths.push_back({});
 
 	node_index nodeIndex = 0;
+	position = m_Root;
 
 	while (m_Nodes[nodeIndex].Child != 0)
 	{
+		// Progressive widening: the next child is added once the visits of the node allow one more
+		const Expansion expansion = m_Expansions[nodeIndex];
+		if (expansion.Generated < expansion.Total && m_Nodes[nodeIndex].Visits / 2 >= m_WideningSimulations[expansion.Generated + 1])
+		{
+			const Position current = m_CompactNodes ? position : m_Positions[nodeIndex];
+			AddChildNodes(nodeIndex, current, GetWidth(nodeIndex) - expansion.Generated);
+		}
+
 		const Node &node = m_Nodes[nodeIndex];
 
-		m_Paths.back().push_back(nodeIndex);
+		batch.Paths.back().push_back(nodeIndex);
 
 		const float totalVisits = node.Visits;
 		float maxScore = -FLT_MAX;
@@ -169,129 +853,191 @@ node_index Tree::SelectNode()
 				nodeIndex = childIndex;
 			}
 		}
+
+		if (m_CompactNodes)
+			position = GetChildPosition(position, nodeIndex, m_ChildBuffer);
 	}
 
+	if (!m_CompactNodes)
+		position = m_Positions[nodeIndex];
+
+	const uint32_t depth = batch.Paths.back().size();
+	Counter<"MCTS Selection Nodes">::Add(depth);
+	m_MaxDepth = std::max(m_MaxDepth, depth);
+	m_DepthSum += depth;
+	m_DepthCount++;
+
 	return nodeIndex;
 }
 
-void Tree::Expand(node_index index)
+void Tree::Expand(Batch &batch, node_index index, const Position &position)
 {
-	m_Paths.back().push_back(index);
-	if (m_Nodes[index].Visits == 0 || m_Nodes[index].Child != 0 || m_Nodes[index].Position.HasLost() || m_Nodes[index].Position.IsDraw())
+	batch.Paths.back().push_back(index);
+
+	const uint32_t threshold = index == 0 ? 1 : m_Expansion.Threshold;
+	if (m_Nodes[index].Visits / 2 < threshold || m_Nodes[index].Child != 0 || position.HasLost() || position.IsDraw())
 	{
-		m_Selected.push_back(m_Nodes[index].Position);
+		batch.Selected.push_back(position);
 		return;
 	}
 
-	m_Nodes[index].Child = m_Nodes.size();
-	AddChildNodes(index);
-	m_Nodes.back().Next = 0;
+	AddChildNodes(index, position, GetWidth(index));
 
 	node_index child = m_Nodes[index].Child;
-	m_Paths.back().push_back(child);
-	m_Selected.push_back(m_Nodes[child].Position);
+	batch.Paths.back().push_back(child);
+	batch.Selected.push_back(m_ChildBuffer[m_Expansions[child].Move]);
 	child = m_Nodes[child].Next;
 
-	while (child != 0 && m_Selected.size() < m_MaxSelectedCount)
+	while (child != 0 && batch.Selected.size() < m_MaxSelectedCount)
 	{
-		m_Paths.push_back(m_Paths.back());
-		m_Paths.back().pop_back();
-		m_Paths.back().push_back(child);
-		m_Selected.push_back(m_Nodes[child].Position);
+		batch.Paths.push_back(batch.Paths.back());
+		batch.Paths.back().pop_back();
+		batch.Paths.back().push_back(child);
+		batch.Selected.push_back(m_ChildBuffer[m_Expansions[child].Move]);
 
 		child = m_Nodes[child].Next;
 	}
 }
 
-void Tree::AddChildNodes(node_index index)
+uint32_t Tree::GetWidth(node_index index) const
 {
-	Bitboard capturing = m_Nodes[index].Position.GetAllCapturing();
+	if (index == 0)
+		return UINT32_MAX;
 
-	if (capturing)
-	{
-		int choices[12];
-		int choiceCnt = Board::GetBits(capturing, choices);
+	// Largest width whose simulations the node has
+	const uint32_t simulations = m_Nodes[index].Visits / 2;
+	const uint32_t *end = std::upper_bound(m_WideningSimulations + 1, std::end(m_WideningSimulations), simulations);
 
-		for (int choiceIdx = 0; choiceIdx < choiceCnt; choiceIdx++)
-			AddCaptures(choices[choiceIdx], m_Nodes[index].Position);
+	return (uint32_t)(end - m_WideningSimulations) - 1;
+}
 
-		return;
-	}
+// Promotions first, then moves after which the opponent has no capture
+static int GetPrior(const Position &parent, const Position &child)
+{
+	const Bitboard before = parent.GetCheckers();
+	const Bitboard after = parent.BlackTurn ? child.Black : child.White;
+	const bool promotion = std::popcount(after & child.Queens) > std::popcount(before & parent.Queens);
 
-	Bitboard moving = m_Nodes[index].Position.GetAllMoving();
-	assert(!Board::IsEmpty(moving));
+	return promotion * 2 + !child.GetAllCapturing();
+}
 
-	int fromChoices[12];
-	int fromChoiceCount = Board::GetBits(moving, fromChoices);
-	for (int i = 0; i < fromChoiceCount; i++)
-	{
-		const int fromIndex = fromChoices[i];
+void Tree::AddChildNodes(node_index index, const Position &position, uint32_t count)
+{
+	// Only the moves are kept between widenings, the children are generated and deduplicated again when the next one is needed
+	// Widening steps are rare next to selections, so this costs less than keeping the children of every partially widened node
+	const uint32_t duplicates = GenerateChildren(position, m_ChildBuffer);
 
-		Bitboard moves = m_Nodes[index].Position.GetMoves(Board::FromIndex(fromIndex));
-		assert(!Board::IsEmpty(moves));
+	Expansion &expansion = m_Expansions[index];
+	if (expansion.Generated == 0)
+		m_DuplicateCaptures += duplicates;
 
-		int toChoices[16];
-		int toChoiceCount = Board::GetBits(moves, toChoices);
-		for (int j = 0; j < toChoiceCount; j++)
-		{
-			const int toIndex = toChoices[j];
+	// Moves are stored in a byte, the ones past the limit are never searched
+	expansion.Total = (uint8_t)std::min<size_t>(m_ChildBuffer.size(), UINT8_MAX);
 
-			Position next = m_Nodes[index].Position;
-		
-			next.Move(fromIndex, toIndex);
-			next.EndTurn();
+	const uint32_t end = std::min<uint32_t>(expansion.Generated + std::min<uint32_t>(count, UINT8_MAX), expansion.Total);
+	if (expansion.Generated == end)
+		return;
 
-			m_Nodes.emplace_back(Node{
-				.Position = next,
-				.Next = (node_index)(m_Nodes.size() + 1),
-			});
-			m_VirtualLoss.emplace_back(0.0f);
-		}
+	// Without widening in the order of the MoveGenerator, otherwise best prior first
+	// The order only depends on the position, so that every widening step of a node agrees on it
+	m_ChildOrder.resize(expansion.Total);
+	std::iota(m_ChildOrder.begin(), m_ChildOrder.end(), 0);
+	if (IsWidening())
+	{
+		int priors[UINT8_MAX];
+		for (uint32_t i = 0; i < expansion.Total; i++)
+			priors[i] = GetPrior(position, m_ChildBuffer[i]);
+
+		std::stable_sort(m_ChildOrder.begin(), m_ChildOrder.end(), [&](uint8_t a, uint8_t b) { return priors[a] > priors[b]; });
 	}
-}
 
-void Tree::AddCaptures(int fromIndex, Position position)
-{
-	Bitboard captures = position.GetCaptures(Board::FromIndex(fromIndex));
+	// Appended after the last child, so that siblings stay in the order they were taken in
+	node_index *link = &m_Nodes[index].Child;
+	while (*link != 0)
+		link = &m_Nodes[*link].Next;
+	*link = m_Nodes.size();
 
-	if (Board::IsEmpty(captures))
+	for (uint32_t i = expansion.Generated; i < end; i++)
 	{
-		position.EndTurn();
+		const uint8_t move = m_ChildOrder[i];
+
 		m_Nodes.emplace_back(Node{
-			.Position = position,
-			.Next = (node_index)(m_Nodes.size() + 1),
+			.Next = (node_index)(i + 1 == end ? 0 : m_Nodes.size() + 1),
 		});
 		m_VirtualLoss.emplace_back(0.0f);
-
-		return;
+		m_Expansions.emplace_back(Expansion{
+			.Move = move
+		});
+		if (!m_CompactNodes)
+			m_Positions.emplace_back(m_ChildBuffer[move]);
 	}
 
-	int choices[8];
-	int choiceCnt = Board::GetBits(captures, choices);
+	// The arena may have moved
+	m_Expansions[index].Generated = end;
+}
 
-	for (int choiceIdx = 0; choiceIdx < choiceCnt; choiceIdx++)
+// Simple moves are counted off piece by piece in the order of GenerateChildren, only captures are generated in full
+static Position GetChild(const Position &parent, uint32_t move, std::vector<Position> &buffer)
+{
+	if (parent.GetAllCapturing())
 	{
-		int toIndex = choices[choiceIdx];
-		Position next = position;
-		next.Capture(fromIndex, toIndex);
+		GenerateChildren(parent, buffer);
+		return buffer[move];
+	}
+
+	int fromChoices[12];
+	int fromChoiceCount = Board::GetBits(parent.GetAllMoving(), fromChoices);
+	for (int i = 0; i < fromChoiceCount; i++)
+	{
+		const Bitboard moves = parent.GetMoves(Board::FromIndex(fromChoices[i]));
+		const uint32_t count = std::popcount(moves);
+		if (move >= count)
+		{
+			move -= count;
+			continue;
+		}
+
+		int toChoices[16];
+		Board::GetBits(moves, toChoices);
 
-		AddCaptures(toIndex, next);
+		Position next = parent;
+		next.Move(fromChoices[i], toChoices[move]);
+		next.EndTurn();
+
+		return next;
 	}
+
+	assert(false);
+	return parent;
 }
 
-void Tree::BackPropagate(const std::vector<int> &blackInc, const std::vector<int> &whiteInc, const std::vector<int> &visitsInc)
+Position Tree::GetChildPosition(const Position &parent, node_index child, std::vector<Position> &buffer) const
 {
-	for (int i = 0; i < m_Paths.size(); i++)
+	if (!m_CompactNodes)
+		return m_Positions[child];
+
+	return GetChild(parent, m_Expansions[child].Move, buffer);
+}
+
+void Tree::BackPropagate(const Batch &batch)
+{
+	for (size_t i = 0; i < batch.Paths.size(); i++)
 	{
-		for (node_index index : m_Paths[i])
+		// Paths start at the root and the side to move alternates along them
+		const std::vector<node_index> &path = batch.Paths[i];
+		for (size_t depth = 0; depth < path.size(); depth++)
 		{
+			const node_index index = path[depth];
+
 			Node &node = m_Nodes[index];
-			node.Visits += visitsInc[i];
-			if (!node.Position.BlackTurn)
-				node.Wins += blackInc[i];
+			node.Visits += batch.VisitsInc[i];
+			if (m_Root.BlackTurn == (depth % 2 == 1))
+				node.Wins += batch.BlackInc[i];
 			else
-				node.Wins += whiteInc[i];
-			m_VirtualLoss[index] = 0.0f;
+				node.Wins += batch.WhiteInc[i];
+
+			// Only the loss added by this batch is removed, the next batch may still be in flight
+			m_VirtualLoss[index] = std::max(m_VirtualLoss[index] - m_VirtualLossIncrement, 0.0f);
 		}
 	}
 }
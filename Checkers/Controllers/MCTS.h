@@ -1,16 +1,26 @@
-#include "Simulator.h"
-#include "Position.h"
+#pragma once
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <stop_token>
+#include <string>
 #include <vector>
 
+#include "Core/Arena.h"
+#include "Core/Instrumentation.h"
+#include "Simulator.h"
+#include "Position.h"
+
 namespace Checkers
 {
 
 using node_index = uint32_t;
 
+// Positions are kept next to the nodes, or rebuilt from the moves with compact nodes
 struct Node
 {
-	Position Position;
 	node_index Child;
 	node_index Next;
 	uint32_t Visits;
@@ -18,6 +28,93 @@ struct Node
 };
 
 static_assert(std::is_standard_layout_v<Node> == true);
+static_assert(sizeof(Node) == 16);
+
+// Lazy expansion and progressive widening, off by default: a leaf gets all of its children after one simulation
+struct ExpansionSettings
+{
+	// Simulations of a leaf before its children are added, the root is expanded after one
+	uint32_t Threshold = 1;
+
+	// A node with n simulations has at most max(Base * n^Exponent, 1) children, the root has all of them
+	// A base of 0 adds every child at once, otherwise children are taken by a cheap prior (promotions, then moves that don't allow a capture)
+	// Every widening step generates the moves of the node again
+	float WideningBase = 0.0f, WideningExponent = 0.5f;
+};
+
+struct SearchMove
+{
+	// Squares of the moving piece, -1 when a capture ends on its starting square
+	int From, To;
+	uint32_t Visits, Wins;
+};
+
+// Summary of the last search
+struct SearchReport
+{
+	Position Root;
+
+	size_t NodeCount, NodeCapacity;
+	size_t ArenaBytes, ArenaCapacityBytes;
+
+	// Simulations include the ones of a reused subtree
+	uint64_t Simulations, ReusedSimulations;
+	std::chrono::microseconds Time;
+
+	double GetSimulationsPerSecond() const;
+
+	uint32_t MaxDepth;
+	float AverageDepth;
+
+	// Capture sequences dropped during expansion because another jump order ended in the same position
+	uint64_t DuplicateCaptures;
+
+	std::vector<SearchMove> RootMoves;
+	std::vector<SearchMove> PrincipalVariation;
+
+	// Timers that ran during the search (process wide, so concurrent searches are included)
+	std::vector<InstrumentValue> Phases;
+
+	std::string ToJson() const;
+};
+
+// State of a search in progress
+struct SearchSnapshot
+{
+	// Position after the most visited root move, the root itself before the first iteration
+	Position BestMove;
+
+	// Simulations include the ones of a reused subtree
+	uint64_t Simulations, ReusedSimulations;
+	size_t NodeCount;
+	std::chrono::microseconds Time;
+
+	// Visits of the second most visited root move
+	uint32_t RunnerUpVisits;
+
+	// Starts with the best move and its visits, empty before the first iteration
+	std::vector<SearchMove> PrincipalVariation;
+};
+
+// Limits of one search, GetDefaultLimits returns the ones passed to the constructor
+struct SearchLimits
+{
+	std::chrono::nanoseconds Time;
+
+	// Work of this search, a reused subtree doesn't count, 0 - unlimited
+	uint64_t Simulations = 0;
+	size_t Nodes = 0;
+
+	// Size of the whole tree, reused nodes included, 0 - unlimited
+	size_t MaxNodes = 0;
+
+	// Set from another thread to end the search early, unlike cancellation the best move so far is returned
+	const std::atomic<bool> *Stop = nullptr;
+
+	// Called from the searching thread with the report of the search so far
+	std::function<void(const SearchReport &)> OnInfo = {};
+	std::chrono::milliseconds InfoInterval = std::chrono::milliseconds(250);
+};
 
 class Tree
 {
@@ -27,11 +124,55 @@ public:
 	Tree(Simulator *simulator, unsigned int maxIterations, std::chrono::milliseconds maxTime, unsigned int selectCount, float explorationConstant = DefaultExplorationConstant, float virtualLoss = 0.01f);
 	~Tree();
 
-	Position FindBestMove(Position position, const int &cancelled);
-	void Print(node_index idx = 0, node_index par = -1, int h = 0, int maxh = 2);
+	// Returns Position() once stop is requested, checked before every selection and passed on to the simulator
+	Position FindBestMove(Position position, std::stop_token stop = {});
+	Position FindBestMove(Position position, std::stop_token stop, const SearchLimits &limits);
+
+	SearchLimits GetDefaultLimits() const;
+
+	// Incremental search: Begin, then Step and Snapshot as often as needed, then End
+	// With an asynchronous simulator a batch stays in flight between steps, so other work can overlap it
+	void Begin(Position position, std::stop_token stop = {});
+
+	// Runs up to iterations batches, returns false once the iteration limit of the constructor is reached or stop is requested
+	bool Step(unsigned int iterations = 1);
+
+	// Doesn't stop the search, results of the batch in flight aren't included yet
+	SearchSnapshot Snapshot() const;
+
+	// Completes the batch in flight, fills the report and returns the best move
+	Position End();
+
+	// Start the next search from the subtree of the previous one when its root is at most two plies below the previous root
+	void SetSubtreeReuse(bool reuse);
+
+	// Discards the tree, a partially widened node can't take its remaining children by other settings
+	void SetExpansion(const ExpansionSettings &settings);
+
+	// Compact nodes don't keep their positions, selection rebuilds them from the moves on the way down
+	// Takes about half the memory per node for move generation at every level, the tree is discarded
+	void SetCompactNodes(bool compact);
+
+	// Rewrites the tree in depth first order once it has threshold nodes and again every time it doubles, 0 - never during a search
+	// A reused subtree is always rewritten in this order between moves
+	void SetReordering(size_t threshold);
+
+	// The node arena is allocated by the first search unless this is called before
+	void Reserve();
+
+	// Maps the node arena and runs one simulation, so that the first search doesn't pay for page faults and lazy simulator setup
+	void WarmUp();
+
+	const SearchReport &GetReport() const;
+
+	void Print(int maxh = 2);
 
 private:
+	// Benchmarks drive the individual tree operations on synthetic trees
+	friend class TreeBench;
+
 	static constexpr size_t StartNodeCount = 250000;
+	static constexpr int MaxReuseDepth = 2;
 
 	Simulator *m_Simulator;
 	unsigned int m_MaxIterations;
@@ -39,23 +180,115 @@ private:
 	float m_ExplorationContant;
 	unsigned int m_MaxSelectedCount;
 	float m_VirtualLossIncrement;
+	bool m_SubtreeReuse = false;
+	bool m_CompactNodes = false;
+	size_t m_ReorderThreshold = 0, m_NextReorder = 0;
+	ExpansionSettings m_Expansion = {};
+
+	// Simulations a node needs to have i children, from the widening settings
+	uint32_t m_WideningSimulations[UINT8_MAX + 1] = {};
+
+	struct Expansion
+	{
+		// Index of the move from the parent among its children
+		uint8_t Move;
+
+		// Children generated so far and legal moves, both 0 until the node is expanded
+		uint8_t Generated, Total;
+	};
+
+	// Leaves selected in one iteration together with the simulation results
+	// With an asynchronous simulator one batch is simulated while the next one is selected
+	struct Batch
+	{
+		std::vector<Position> Selected = {};
+		std::vector<std::vector<node_index>> Paths = {};
+
+		std::vector<int> BlackInc = {}, WhiteInc = {}, VisitsInc = {};
+
+		SimulationTicket Ticket = 0;
+		bool InFlight = false, Ready = false;
+		uint64_t SubmittedTicks = 0, CompletedTicks = 0;
+	};
+
+	// Large enough to be mapped by the Arena, with huge pages if its page mode asks for them
+	ArenaVector<Node> m_Nodes = {};
+	ArenaVector<float> m_VirtualLoss = {};
+	ArenaVector<Expansion> m_Expansions = {};
+
+	// Parallel to the nodes, empty with compact nodes
+	ArenaVector<Position> m_Positions = {};
+	Position m_Root = {};
+
+	Batch m_Batches[2] = {};
+
+	// Children of the node being expanded, in the order of the MoveGenerator
+	std::vector<Position> m_ChildBuffer = {};
+
+	// Indices into the buffer in the order the node takes its children
+	std::vector<uint8_t> m_ChildOrder = {};
+
+	// Depth of selected leaves
+	uint32_t m_MaxDepth = 0;
+	uint64_t m_DepthSum = 0, m_DepthCount = 0;
+	uint64_t m_DuplicateCaptures = 0;
+	uint64_t m_ReusedSimulations = 0;
+	size_t m_ReusedNodes = 0;
+
+	// State of the search between Begin and End
+	Batch *m_Current = &m_Batches[0], *m_Next = &m_Batches[1];
+	uint64_t m_Iterations = 0;
+	std::chrono::high_resolution_clock::time_point m_Start = {};
+	std::vector<InstrumentValue> m_PhasesBefore = {};
+
+	struct CancelSimulator
+	{
+		Simulator *Target;
+		void operator()() const { Target->Cancel(); }
+	};
+
+	std::stop_token m_Stop = {};
+	std::optional<std::stop_callback<CancelSimulator>> m_OnStop = {};
+
+	SearchReport m_Report = {};
+
+	bool ReuseSubtree(const Position &position);
+	node_index FindDescendant(node_index index, const Position &nodePosition, const Position &position, int depth);
+
+	// Copies the subtree of root to the front of new arenas, every sibling group stays contiguous and the groups follow
+	// a depth first walk that takes the most visited child first, so the hot paths of selection are next to each other
+	void Reorder(node_index root);
+
+	void Iterate();
+	void Finish();
+
+	void SelectBatch(Batch &batch, Batch *inFlight);
+	// Returns the leaf and its position
+	node_index SelectNode(Batch &batch, Position &position);
+	void Expand(Batch &batch, node_index index, const Position &position);
+
+	bool IsWidening() const;
+	uint32_t GetWidth(node_index index) const;
 
-	std::vector<Node> m_Nodes = {};
-	std::vector<float> m_VirtualLoss = {};
-	std::vector<Position> m_Selected = {};
-	std::vector<std::vector<node_index>> m_Paths = {};
+	// Leaves the positions of all children in the buffer
+	void AddChildNodes(node_index index, const Position &position, uint32_t count);
 
-	node_index SelectNode();
-	void Expand(node_index index);
+	// The buffer is used for compact nodes whose parent has captures
+	Position GetChildPosition(const Position &parent, node_index child, std::vector<Position> &buffer) const;
 
-	void AddChildNodes(node_index index);
-	void AddCaptures(int fromIndex, Position position);
+	void SubmitBatch(Batch &batch);
+	void PollBatch(Batch &batch);
+	void CompleteBatch(Batch &batch);
 
-	void BackPropagate(const std::vector<int> &blackInc, const std::vector<int> &whiteInc, const std::vector<int> &visitsInc);
+	void BackPropagate(const Batch &batch);
 
+	node_index GetBestChild() const;
 	Position GetBestMove();
+	void GetPrincipalVariation(std::vector<SearchMove> &moves) const;
+	void FillReport(std::chrono::nanoseconds time, const std::vector<InstrumentValue> &phasesBefore);
 
 	float GetNodeScore(node_index index);
+	void Print(node_index idx, node_index par, const Position &position, int h, int maxh);
 };
 
 }
\ No newline at end of file
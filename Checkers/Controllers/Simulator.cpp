@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cassert>
+
+#ifdef CHECKERS_CUDA
+#include "GraphicsCardConfig.h"
+#endif
+
+#include "HostSimulator.h"
+#include "Simulator.h"
+#include "ThreadedHostSimulator.h"
+
+namespace Checkers
+{
+
+static Simulator *CreateHostBackend(unsigned int batchSize, unsigned int threadCount)
+{
+	return Simulator::CreateHost();
+}
+
+static Simulator *CreateThreadedHostBackend(unsigned int batchSize, unsigned int threadCount)
+{
+	return Simulator::CreateThreadedHost(threadCount);
+}
+
+#ifdef CHECKERS_CUDA
+// One block per position, without a thread count blocks get the shape SimulatorPool uses
+static Simulator *CreateDeviceBackend(unsigned int batchSize, unsigned int threadCount)
+{
+	return Simulator::CreateDevice(batchSize, threadCount == 0 ? (unsigned int)GetThreadsPerSm() : threadCount);
+}
+#endif
+
+static const SimulatorBackend s_Backends[] = {
+	{ "host", CreateHostBackend },
+	{ "threaded", CreateThreadedHostBackend },
+#ifdef CHECKERS_CUDA
+	{ "device", CreateDeviceBackend },
+#endif
+};
+
+Simulator *Simulator::CreateHost()
+{
+	return new HostSimulator();
+}
+
+Simulator *Simulator::CreateThreadedHost(unsigned int threadCount, unsigned int playoutsPerPosition)
+{
+	return new ThreadedHostSimulator(threadCount, playoutsPerPosition);
+}
+
+SimulationTicket Simulator::Submit(std::span<const Position> positions)
+{
+	m_Positions.assign(positions.begin(), positions.end());
+	m_BlackInc.resize(positions.size());
+	m_WhiteInc.resize(positions.size());
+	m_VisitsInc.resize(positions.size());
+
+	Simulate(m_Positions, m_BlackInc, m_WhiteInc, m_VisitsInc);
+
+	return ++m_LastTicket;
+}
+
+bool Simulator::Poll(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc)
+{
+	Wait(ticket, blackInc, whiteInc, visitsInc);
+	return true;
+}
+
+void Simulator::Wait(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc)
+{
+	assert(ticket == m_LastTicket);
+
+	std::copy(m_BlackInc.begin(), m_BlackInc.end(), blackInc.begin());
+	std::copy(m_WhiteInc.begin(), m_WhiteInc.end(), whiteInc.begin());
+	std::copy(m_VisitsInc.begin(), m_VisitsInc.end(), visitsInc.begin());
+}
+
+std::span<const SimulatorBackend> Simulator::GetBackends()
+{
+	return s_Backends;
+}
+
+}
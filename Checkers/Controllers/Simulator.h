@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <span>
 #include <vector>
 
 #include "Position.h"
@@ -7,16 +9,70 @@
 namespace Checkers
 {
 
+class Simulator;
+
+struct SimulatorBackend
+{
+	const char *Name;
+
+	// batchSize - maximum number of positions simulated in one call
+	// threadCount - parallel playouts (worker threads on the host, threads per block on the device), 0 for the default of the backend
+	Simulator *(*Create)(unsigned int batchSize, unsigned int threadCount);
+};
+
+using SimulationTicket = uint64_t;
+
 class Simulator
 {
 public:
+	// Number of batches an asynchronous simulator accepts before Submit blocks
+	static constexpr size_t MaxBatchesInFlight = 2;
+
 	Simulator() = default;
 	virtual ~Simulator() = default;
 
+	// Blocking call, results are written for every position
 	virtual void Simulate(const std::vector<Position> &positions, std::vector<int> &blackInc, std::vector<int> &whiteInc, std::vector<int> &visitsInc) = 0;
 
+	// Asynchronous interface, the default implementation simulates synchronously in Submit
+	// Results are written by Poll (when it returns true) or Wait, after which the ticket is released
+	virtual SimulationTicket Submit(std::span<const Position> positions);
+	virtual bool Poll(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc);
+	virtual void Wait(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc);
+
+	// Whether Submit returns before the batch is simulated
+	virtual bool IsAsynchronous() const { return false; }
+
+	// Thread safe, finishes the batches submitted so far as soon as possible
+	// Positions whose playouts didn't run come back with zero visits, later batches aren't affected
+	virtual void Cancel() {}
+
+	// Total plies played in playouts so far, 0 if the backend doesn't count them
+	virtual uint64_t GetPlyCount() const { return 0; }
+
 	static Simulator *CreateHost();
+	static Simulator *CreateThreadedHost(unsigned int threadCount, unsigned int playoutsPerPosition = 1);
+#ifdef CHECKERS_CUDA
 	static Simulator *CreateDevice(unsigned int blockCount, unsigned int threadsPerBlock);
+#endif
+
+	static constexpr bool IsDeviceAvailable()
+	{
+#ifdef CHECKERS_CUDA
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// All backends compiled into this build
+	static std::span<const SimulatorBackend> GetBackends();
+
+private:
+	SimulationTicket m_LastTicket = 0;
+
+	std::vector<Position> m_Positions = {};
+	std::vector<int> m_BlackInc = {}, m_WhiteInc = {}, m_VisitsInc = {};
 };
 
 }
@@ -0,0 +1,60 @@
+#ifdef CHECKERS_CUDA
+#include "GraphicsCardConfig.h"
+#endif
+
+#include "SimulatorPool.h"
+
+namespace Checkers
+{
+
+std::mutex SimulatorPool::s_Mutex;
+
+SimulationBatcher *SimulatorPool::s_ThreadedHost = nullptr;
+SimulationBatcher *SimulatorPool::s_Device = nullptr;
+
+SimulationBatcher *SimulatorPool::Get(ControllerType type)
+{
+	std::lock_guard lock(s_Mutex);
+
+	switch (type)
+	{
+	case ControllerType::ComputerThreadedHostController:
+		if (s_ThreadedHost == nullptr)
+			s_ThreadedHost = new SimulationBatcher(Simulator::CreateThreadedHost(0), ThreadedHostBatchSize, std::chrono::microseconds(0));
+		return s_ThreadedHost;
+#ifdef CHECKERS_CUDA
+	case ControllerType::ComputerDeviceController:
+		if (s_Device == nullptr)
+		{
+			const unsigned int blockCount = GetSmCount() * BlocksPerSm;
+			s_Device = new SimulationBatcher(Simulator::CreateDevice(blockCount, GetThreadsPerSm()), blockCount, std::chrono::microseconds(0));
+		}
+		return s_Device;
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+unsigned int SimulatorPool::GetBatchSize(ControllerType type)
+{
+	SimulationBatcher *pool = Get(type);
+	return pool == nullptr ? 1 : (unsigned int)pool->GetBatchSize();
+}
+
+std::vector<BatchingClientStats> SimulatorPool::GetClientStats()
+{
+	std::vector<BatchingClientStats> stats;
+
+	std::lock_guard lock(s_Mutex);
+	for (SimulationBatcher *pool : { s_ThreadedHost, s_Device })
+		if (pool != nullptr)
+		{
+			std::vector<BatchingClientStats> clients = pool->GetClientStats();
+			stats.insert(stats.end(), clients.begin(), clients.end());
+		}
+
+	return stats;
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "BatchingSimulator.h"
+#include "Controller.h"
+
+namespace Checkers
+{
+
+// Simulators shared by all controllers of the process, created on first use
+// Concurrent searches (both sides of a game, many sessions, pondering) take turns on one set of
+// worker threads or one device instead of oversubscribing it
+// The host controller keeps a simulator of its own, a single thread gains nothing from batching
+class SimulatorPool
+{
+public:
+	// nullptr for controller types that don't simulate through a pool
+	static SimulationBatcher *Get(ControllerType type);
+
+	// Positions a tree should select per batch, the pool dispatches at most this many at once
+	static unsigned int GetBatchSize(ControllerType type);
+
+	// Utilization of the created pools by each of their clients
+	static std::vector<BatchingClientStats> GetClientStats();
+
+private:
+	// Device shape per streaming multiprocessor
+	static constexpr int BlocksPerSm = 2;
+	static constexpr unsigned int ThreadedHostBatchSize = 64;
+
+	static std::mutex s_Mutex;
+
+	// Never destroyed, controllers may release their clients during static destruction
+	static SimulationBatcher *s_ThreadedHost;
+	static SimulationBatcher *s_Device;
+};
+
+}
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cassert>
+#include <random>
+
+#include "ThreadedHostSimulator.h"
+
+namespace Checkers
+{
+
+ThreadedHostSimulator::ThreadedHostSimulator(unsigned int threadCount, unsigned int playoutsPerPosition)
+	: m_PlayoutsPerPosition(std::max(playoutsPerPosition, 1u))
+{
+	if (threadCount == 0)
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	std::random_device dev;
+
+	m_Workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+		m_Workers.emplace_back(&ThreadedHostSimulator::WorkerLoop, this, dev());
+}
+
+ThreadedHostSimulator::~ThreadedHostSimulator()
+{
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_WorkReady.notify_all();
+
+	for (std::thread &worker : m_Workers)
+		worker.join();
+}
+
+void ThreadedHostSimulator::Simulate(const std::vector<Position> &positions, std::vector<int> &blackInc, std::vector<int> &whiteInc, std::vector<int> &visitsInc)
+{
+	SimulationTicket ticket = Submit(positions);
+
+	Wait(ticket, std::span(blackInc).first(positions.size()), std::span(whiteInc).first(positions.size()), std::span(visitsInc).first(positions.size()));
+
+	std::fill(blackInc.begin() + positions.size(), blackInc.end(), 0);
+	std::fill(whiteInc.begin() + positions.size(), whiteInc.end(), 0);
+	std::fill(visitsInc.begin() + positions.size(), visitsInc.end(), 0);
+}
+
+SimulationTicket ThreadedHostSimulator::Submit(std::span<const Position> positions)
+{
+	std::unique_lock lock(m_Mutex);
+
+	Batch *batch = nullptr;
+	m_SlotFree.wait(lock, [&] {
+		auto it = std::find_if(m_Batches.begin(), m_Batches.end(), [](const Batch &batch) { return !batch.InUse; });
+		batch = it == m_Batches.end() ? nullptr : &*it;
+		return batch != nullptr;
+	});
+
+	batch->Ticket = m_NextTicket++;
+	batch->InUse = true;
+	batch->Positions.assign(positions.begin(), positions.end());
+	batch->BlackInc.resize(positions.size());
+	batch->WhiteInc.resize(positions.size());
+	batch->VisitsInc.resize(positions.size());
+	batch->Claimed = 0;
+	batch->Completed = 0;
+	batch->Cancelled.store(false, std::memory_order_relaxed);
+
+	SimulationTicket ticket = batch->Ticket;
+
+	lock.unlock();
+	m_WorkReady.notify_all();
+
+	return ticket;
+}
+
+bool ThreadedHostSimulator::Poll(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc)
+{
+	std::unique_lock lock(m_Mutex);
+
+	Batch *batch = FindBatch(ticket);
+	assert(batch != nullptr);
+
+	if (batch->Completed != batch->Positions.size())
+		return false;
+
+	ReleaseBatch(*batch, blackInc, whiteInc, visitsInc);
+	lock.unlock();
+	m_SlotFree.notify_one();
+
+	return true;
+}
+
+void ThreadedHostSimulator::Wait(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc)
+{
+	std::unique_lock lock(m_Mutex);
+
+	Batch *batch = FindBatch(ticket);
+	assert(batch != nullptr);
+
+	m_BatchDone.wait(lock, [&] { return batch->Completed == batch->Positions.size(); });
+
+	ReleaseBatch(*batch, blackInc, whiteInc, visitsInc);
+	lock.unlock();
+	m_SlotFree.notify_one();
+}
+
+void ThreadedHostSimulator::Cancel()
+{
+	std::unique_lock lock(m_Mutex);
+
+	bool done = false;
+	for (Batch &batch : m_Batches)
+	{
+		if (!batch.InUse)
+			continue;
+
+		batch.Cancelled.store(true, std::memory_order_relaxed);
+
+		// Positions no worker claimed yet are completed right away
+		std::fill(batch.BlackInc.begin() + batch.Claimed, batch.BlackInc.end(), 0);
+		std::fill(batch.WhiteInc.begin() + batch.Claimed, batch.WhiteInc.end(), 0);
+		std::fill(batch.VisitsInc.begin() + batch.Claimed, batch.VisitsInc.end(), 0);
+
+		batch.Completed += batch.Positions.size() - batch.Claimed;
+		batch.Claimed = batch.Positions.size();
+
+		done |= batch.Completed == batch.Positions.size();
+	}
+
+	lock.unlock();
+	if (done)
+		m_BatchDone.notify_all();
+}
+
+uint64_t ThreadedHostSimulator::GetPlyCount() const
+{
+	std::lock_guard lock(m_Mutex);
+	return m_PlyCount;
+}
+
+ThreadedHostSimulator::Batch *ThreadedHostSimulator::FindBatch(SimulationTicket ticket)
+{
+	for (Batch &batch : m_Batches)
+		if (batch.InUse && batch.Ticket == ticket)
+			return &batch;
+
+	return nullptr;
+}
+
+ThreadedHostSimulator::Batch *ThreadedHostSimulator::FindPendingBatch()
+{
+	// Oldest batch first, so that the batch the tree waits on finishes first
+	Batch *pending = nullptr;
+	for (Batch &batch : m_Batches)
+		if (batch.InUse && batch.Claimed < batch.Positions.size() && (pending == nullptr || batch.Ticket < pending->Ticket))
+			pending = &batch;
+
+	return pending;
+}
+
+void ThreadedHostSimulator::ReleaseBatch(Batch &batch, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc)
+{
+	assert(blackInc.size() >= batch.Positions.size());
+
+	std::copy(batch.BlackInc.begin(), batch.BlackInc.end(), blackInc.begin());
+	std::copy(batch.WhiteInc.begin(), batch.WhiteInc.end(), whiteInc.begin());
+	std::copy(batch.VisitsInc.begin(), batch.VisitsInc.end(), visitsInc.begin());
+
+	batch.InUse = false;
+}
+
+void ThreadedHostSimulator::WorkerLoop(unsigned int seed)
+{
+	HostGenerator generator(seed);
+
+	std::unique_lock lock(m_Mutex);
+	while (true)
+	{
+		Batch *batch = nullptr;
+		m_WorkReady.wait(lock, [&] {
+			batch = FindPendingBatch();
+			return m_Stopping || batch != nullptr;
+		});
+
+		if (m_Stopping)
+			return;
+
+		// Claim a chunk so that every worker gets a few chunks of the batch,
+		// this balances uneven playout lengths while keeping the lock mostly uncontended
+		const size_t chunk = std::max<size_t>(batch->Positions.size() / (m_Workers.size() * 4), 1);
+		const size_t begin = batch->Claimed;
+		const size_t end = std::min(begin + chunk, batch->Positions.size());
+		batch->Claimed = end;
+
+		lock.unlock();
+
+		uint64_t plies = 0;
+		for (size_t i = begin; i < end; i++)
+		{
+			int blackSum = 0, whiteSum = 0;
+			unsigned int playouts = 0;
+			for (; playouts < m_PlayoutsPerPosition && !batch->Cancelled.load(std::memory_order_relaxed); playouts++)
+			{
+				int blackInc, whiteInc;
+				Position position = batch->Positions[i];
+				plies += position.SimulateOne(generator, blackInc, whiteInc);
+
+				blackSum += blackInc;
+				whiteSum += whiteInc;
+			}
+
+			batch->BlackInc[i] = blackSum;
+			batch->WhiteInc[i] = whiteSum;
+			batch->VisitsInc[i] = playouts * 2;
+		}
+
+		lock.lock();
+
+		m_PlyCount += plies;
+		batch->Completed += end - begin;
+		if (batch->Completed == batch->Positions.size())
+			m_BatchDone.notify_all();
+	}
+}
+
+}
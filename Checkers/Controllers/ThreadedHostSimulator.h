@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "HostSimulator.h"
+#include "Simulator.h"
+
+namespace Checkers
+{
+
+class ThreadedHostSimulator : public Simulator
+{
+public:
+	ThreadedHostSimulator(unsigned int threadCount, unsigned int playoutsPerPosition);
+	~ThreadedHostSimulator() override;
+
+	void Simulate(const std::vector<Position> &positions, std::vector<int> &blackInc, std::vector<int> &whiteInc, std::vector<int> &visitsInc) override;
+
+	SimulationTicket Submit(std::span<const Position> positions) override;
+	bool Poll(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc) override;
+	void Wait(SimulationTicket ticket, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc) override;
+
+	bool IsAsynchronous() const override { return true; }
+
+	// Workers stop between playouts, so a cancelled batch completes within one playout per worker
+	void Cancel() override;
+
+	uint64_t GetPlyCount() const override;
+
+private:
+	struct Batch
+	{
+		SimulationTicket Ticket = 0;
+		bool InUse = false;
+
+		std::vector<Position> Positions = {};
+		std::vector<int> BlackInc = {}, WhiteInc = {}, VisitsInc = {};
+
+		// Positions handed out to workers and positions with written results
+		size_t Claimed = 0, Completed = 0;
+
+		// Read by the workers without the lock
+		std::atomic<bool> Cancelled = false;
+	};
+
+	unsigned int m_PlayoutsPerPosition;
+
+	std::vector<std::thread> m_Workers;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_WorkReady;
+	std::condition_variable m_BatchDone;
+	std::condition_variable m_SlotFree;
+
+	std::array<Batch, MaxBatchesInFlight> m_Batches;
+	SimulationTicket m_NextTicket = 1;
+	uint64_t m_PlyCount = 0;
+	bool m_Stopping = false;
+
+	Batch *FindBatch(SimulationTicket ticket);
+	Batch *FindPendingBatch();
+	void ReleaseBatch(Batch &batch, std::span<int> blackInc, std::span<int> whiteInc, std::span<int> visitsInc);
+
+	void WorkerLoop(unsigned int seed);
+};
+
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+
+#include "TimeManager.h"
+
+namespace Checkers
+{
+
+TimeManager::TimeManager(std::chrono::milliseconds moveTime) : m_MoveTime(moveTime)
+{
+}
+
+void TimeManager::SetClock(const Clock &clock)
+{
+	m_Clock = clock;
+
+	if (clock.MoveNumber == 0)
+		m_Stats = {};
+}
+
+void TimeManager::Start(bool forced)
+{
+	m_Start = std::chrono::steady_clock::now();
+	m_Forced = forced;
+	m_StoppedEarly = false;
+	m_Extensions = 0;
+	m_LastCheck = {};
+	m_Best = {};
+	m_BestSince = {};
+
+	if (m_Clock.Remaining == std::chrono::nanoseconds::max())
+	{
+		m_Target = m_MoveTime;
+		m_Maximum = m_MoveTime * 2;
+	}
+	else
+	{
+		const std::chrono::nanoseconds available = std::max<std::chrono::nanoseconds>(m_Clock.Remaining - Overhead, std::chrono::milliseconds(1));
+
+		m_Maximum = available / 2;
+		m_Target = std::min(available / MovesToGo + m_Clock.Increment * 3 / 4, m_Maximum);
+		m_Maximum = std::min(m_Maximum, m_Target * 3);
+	}
+
+	m_Deadline = m_Target;
+	m_Clock = {};
+}
+
+bool TimeManager::Update(const Tree &tree)
+{
+	const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - m_Start;
+	if (elapsed >= m_Maximum)
+		return true;
+
+	if (elapsed < m_Deadline && elapsed - m_LastCheck < GetCheckInterval())
+		return false;
+	m_LastCheck = elapsed;
+
+	const SearchSnapshot snapshot = tree.Snapshot();
+	if (snapshot.PrincipalVariation.empty())
+		return elapsed >= m_Deadline;
+
+	if (snapshot.BestMove != m_Best)
+	{
+		m_Best = snapshot.BestMove;
+		m_BestSince = elapsed;
+	}
+
+	if (elapsed >= m_Deadline)
+	{
+		// The lead changed hands late, the new best move gets time to prove itself
+		if (m_Extensions < MaxExtensions && elapsed - m_BestSince < m_Target / 4)
+		{
+			m_Extensions++;
+			m_Deadline = std::min(m_Deadline + m_Target / 2, m_Maximum);
+			return false;
+		}
+
+		return true;
+	}
+
+	// The simulation rate needs a few checks to settle
+	const uint64_t simulations = snapshot.Simulations - snapshot.ReusedSimulations;
+	if (elapsed < m_Target / 10 || simulations == 0)
+		return false;
+
+	// Even with every simulation left until the deadline (two visits each) the runner-up couldn't overtake
+	const double remaining = simulations * (std::chrono::duration<double>(m_Deadline - elapsed) / std::chrono::duration<double>(elapsed));
+	const uint32_t lead = snapshot.PrincipalVariation.front().Visits - snapshot.RunnerUpVisits;
+	if (lead > 2.0 * remaining)
+	{
+		m_StoppedEarly = true;
+		return true;
+	}
+
+	return false;
+}
+
+void TimeManager::Finish()
+{
+	const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - m_Start;
+
+	m_Stats.Moves++;
+	m_Stats.Forced += m_Forced;
+	m_Stats.StoppedEarly += m_StoppedEarly;
+	m_Stats.Extended += m_Extensions != 0;
+	m_Stats.Saved += m_Target - elapsed;
+	m_Stats.Used += elapsed;
+}
+
+std::chrono::nanoseconds TimeManager::GetCheckInterval() const
+{
+	return std::clamp<std::chrono::nanoseconds>(m_Target / 50, std::chrono::milliseconds(1), std::chrono::milliseconds(10));
+}
+
+}
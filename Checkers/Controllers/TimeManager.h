@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#include "Controller.h"
+#include "MCTS.h"
+
+namespace Checkers
+{
+
+// Time management of one side since the start of its game
+struct TimeStats
+{
+	size_t Moves, Forced, StoppedEarly, Extended;
+
+	// Target time of the moves minus the time they took, negative when extensions took more
+	std::chrono::nanoseconds Saved, Used;
+};
+
+// Splits the clock between moves and decides when a search should stop
+// Without a clock every move targets the move time and may be extended up to twice that
+class TimeManager
+{
+public:
+	// Moves the remaining time is expected to last
+	static constexpr unsigned int MovesToGo = 30;
+
+	// Kept on the clock for the overhead outside of the search
+	static constexpr std::chrono::milliseconds Overhead = std::chrono::milliseconds(20);
+
+	static constexpr unsigned int MaxExtensions = 2;
+
+	TimeManager(std::chrono::milliseconds moveTime);
+
+	// Applies to the next move only, the first move of a game starts its stats over
+	void SetClock(const Clock &clock);
+
+	// Forced moves are played right away
+	void Start(bool forced);
+
+	// Called after every step of the search, returns true once it should stop
+	bool Update(const Tree &tree);
+
+	void Finish();
+
+	std::chrono::nanoseconds GetTarget() const { return m_Target; }
+	std::chrono::nanoseconds GetMaximum() const { return m_Maximum; }
+
+	const TimeStats &GetGameStats() const { return m_Stats; }
+
+private:
+	std::chrono::milliseconds m_MoveTime;
+	Clock m_Clock = {};
+
+	std::chrono::steady_clock::time_point m_Start = {};
+	std::chrono::nanoseconds m_Target = {}, m_Maximum = {}, m_Deadline = {};
+	std::chrono::nanoseconds m_LastCheck = {};
+	bool m_Forced = false, m_StoppedEarly = false;
+	unsigned int m_Extensions = 0;
+
+	// Most visited root move at the last check and when it took the lead
+	Position m_Best = {};
+	std::chrono::nanoseconds m_BestSince = {};
+
+	TimeStats m_Stats = {};
+
+	std::chrono::nanoseconds GetCheckInterval() const;
+};
+
+}
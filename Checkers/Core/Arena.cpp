@@ -0,0 +1,182 @@
+#include "Arena.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Checkers
+{
+
+static std::atomic<PageMode> s_PageMode = PageMode::Default;
+
+static std::atomic<uint64_t> s_Mappings[(size_t)PageMode::Count] = {};
+static std::atomic<uint64_t> s_Bytes[(size_t)PageMode::Count] = {};
+static std::atomic<uint64_t> s_NumaBound = 0;
+
+void Arena::SetPageMode(PageMode mode)
+{
+	s_PageMode = mode;
+}
+
+PageMode Arena::GetPageMode()
+{
+	return s_PageMode;
+}
+
+#ifdef __linux__
+
+static size_t RoundUp(size_t bytes)
+{
+	return (bytes + Arena::HugePageSize - 1) / Arena::HugePageSize * Arena::HugePageSize;
+}
+
+static bool IsNuma()
+{
+	static const bool numa = access("/sys/devices/system/node/node1", F_OK) == 0;
+	return numa;
+}
+
+// Prefers the node of the calling thread, the pages are still allocated on first touch
+static bool BindToCurrentNode(void *pointer, size_t bytes)
+{
+	unsigned int cpu, node;
+	if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+		return false;
+
+	unsigned long mask[4] = {};
+	constexpr unsigned long bits = 8 * sizeof(unsigned long);
+	if (node >= bits * std::size(mask))
+		return false;
+	mask[node / bits] = 1ul << (node % bits);
+
+	return syscall(SYS_mbind, pointer, bytes, MPOL_PREFERRED, mask, bits * std::size(mask), 0) == 0;
+}
+
+// Over-maps by a huge page and unmaps the unaligned ends, so that the kernel can back the whole block with huge pages
+static void *MapAligned(size_t bytes)
+{
+	const size_t length = bytes + Arena::HugePageSize;
+	void *mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED)
+		return nullptr;
+
+	const uintptr_t start = (uintptr_t)mapping;
+	const uintptr_t aligned = (start + Arena::HugePageSize - 1) / Arena::HugePageSize * Arena::HugePageSize;
+	if (aligned != start)
+		munmap(mapping, aligned - start);
+	if (const size_t tail = start + length - (aligned + bytes); tail != 0)
+		munmap((void *)(aligned + bytes), tail);
+
+	return (void *)aligned;
+}
+
+void *Arena::Allocate(size_t bytes)
+{
+	if (bytes < MinMappedBytes)
+		return ::operator new(bytes);
+
+	const size_t length = RoundUp(bytes);
+	PageMode mode = s_PageMode;
+	void *pointer = nullptr;
+
+	if (mode == PageMode::Explicit)
+	{
+		pointer = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (pointer == MAP_FAILED)
+		{
+			pointer = nullptr;
+			mode = PageMode::Transparent;
+		}
+	}
+
+	if (mode == PageMode::Transparent)
+	{
+		pointer = MapAligned(length);
+		if (pointer != nullptr && madvise(pointer, length, MADV_HUGEPAGE) != 0)
+			mode = PageMode::Default;
+	}
+	else if (mode == PageMode::Default)
+	{
+		pointer = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (pointer == MAP_FAILED)
+			pointer = nullptr;
+	}
+
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+
+	if (IsNuma() && BindToCurrentNode(pointer, length))
+		s_NumaBound++;
+
+	s_Mappings[(size_t)mode]++;
+	s_Bytes[(size_t)mode] += length;
+
+	return pointer;
+}
+
+void Arena::Free(void *pointer, size_t bytes)
+{
+	if (bytes < MinMappedBytes)
+		::operator delete(pointer);
+	else
+		munmap(pointer, RoundUp(bytes));
+}
+
+#else
+
+void *Arena::Allocate(size_t bytes)
+{
+	return ::operator new(bytes);
+}
+
+void Arena::Free(void *pointer, size_t bytes)
+{
+	::operator delete(pointer);
+}
+
+#endif
+
+ArenaStats Arena::GetStats()
+{
+	ArenaStats stats = {};
+	for (size_t i = 0; i < (size_t)PageMode::Count; i++)
+	{
+		stats.Mappings[i] = s_Mappings[i];
+		stats.Bytes[i] = s_Bytes[i];
+	}
+	stats.NumaBound = s_NumaBound;
+
+	return stats;
+}
+
+const char *Arena::GetName(PageMode mode)
+{
+	switch (mode)
+	{
+	case PageMode::Default: return "default";
+	case PageMode::Transparent: return "transparent";
+	case PageMode::Explicit: return "explicit";
+	default: return "unknown";
+	}
+}
+
+bool Arena::ParsePageMode(const char *name, PageMode &mode)
+{
+	for (size_t i = 0; i < (size_t)PageMode::Count; i++)
+		if (std::strcmp(name, GetName((PageMode)i)) == 0)
+		{
+			mode = (PageMode)i;
+			return true;
+		}
+
+	return false;
+}
+
+}
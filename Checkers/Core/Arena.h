@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Checkers
+{
+
+enum class PageMode
+{
+	// Pages of the default size, with transparent huge pages set to always the kernel may still use huge ones
+	Default,
+
+	// Aligned to huge pages and advised with madvise(MADV_HUGEPAGE)
+	Transparent,
+
+	// Reserved huge pages (MAP_HUGETLB, vm.nr_hugepages), Transparent when none are left
+	Explicit,
+
+	Count
+};
+
+// Mappings made since the start of the process, by the mode they got after fallbacks
+struct ArenaStats
+{
+	std::array<uint64_t, (size_t)PageMode::Count> Mappings, Bytes;
+
+	// Mappings bound to the NUMA node of the allocating thread, only on hosts with more than one node
+	uint64_t NumaBound;
+};
+
+// Memory of the search tree arenas
+// Blocks of at least MinMappedBytes are mapped directly on Linux, so that they can use huge pages
+// and be placed on the NUMA node of the thread that allocates them, smaller ones and other platforms use operator new
+class Arena
+{
+public:
+	static constexpr size_t HugePageSize = 2 * 1024 * 1024;
+	static constexpr size_t MinMappedBytes = HugePageSize;
+
+	// Applies to blocks allocated afterwards
+	static void SetPageMode(PageMode mode);
+	static PageMode GetPageMode();
+
+	static void *Allocate(size_t bytes);
+	static void Free(void *pointer, size_t bytes);
+
+	static ArenaStats GetStats();
+
+	static const char *GetName(PageMode mode);
+
+	// Returns false for an unknown name
+	static bool ParsePageMode(const char *name, PageMode &mode);
+};
+
+template<typename T>
+struct ArenaAllocator
+{
+	using value_type = T;
+
+	ArenaAllocator() = default;
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U> &) {}
+
+	T *allocate(size_t count)
+	{
+		return static_cast<T *>(Arena::Allocate(count * sizeof(T)));
+	}
+
+	void deallocate(T *pointer, size_t count)
+	{
+		Arena::Free(pointer, count * sizeof(T));
+	}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U> &) const { return true; }
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}
@@ -1,58 +1,101 @@
 #include "Core.h"
 
 #include <iostream>
+#include <stdexcept>
 
 namespace Checkers
 {
 
+std::mutex Stats::s_Mutex;
 std::map<std::string, std::string> Stats::s_Stats = {};
-std::map<std::string, std::chrono::nanoseconds> Stats::s_Measurements = {};
-
-void Stats::AddMeasurement(const std::string &timer, std::chrono::nanoseconds measurement)
-{
-	s_Measurements[timer] += measurement;
-}
+std::vector<InstrumentValue> Stats::s_Flushed = {};
 
 void Stats::Clear()
 {
+	std::lock_guard lock(s_Mutex);
 	s_Stats.clear();
-	s_Measurements.clear();
+	s_Flushed = Instrumentation::Snapshot();
 }
 
-void Stats::FlushTimers()
+// Misses per unit of work, a call of the scope or a node for scopes that record their nodes
+static std::string FormatPerfValues(const char *name, const PerfValues &perf, uint64_t count, const char *unit)
 {
-	for (const auto& [timer, measurement] : s_Measurements)
-	{
-		Stats::AddStat(timer, "{}: {:.3f} ms", timer,
-			std::chrono::duration_cast<std::chrono::microseconds>(measurement).count() / 1000.0f
-		);
-	}
-	s_Measurements.clear();
+	const double cycles = perf[(size_t)PerfEvent::Cycles];
+	std::string stat = std::format("{}: IPC {:.2f}", name, perf[(size_t)PerfEvent::Instructions] / cycles);
+
+	for (PerfEvent event : { PerfEvent::L1DMisses, PerfEvent::LLCMisses, PerfEvent::BranchMisses, PerfEvent::DTLBMisses })
+		if (perf[(size_t)event] != 0)
+			stat += std::format(", {} {:.1f}", PerfCounters::GetName(event), perf[(size_t)event] / (double)count);
+
+	return std::format("{} per {}", stat, unit);
 }
 
-const std::map<std::string, std::string> &Stats::GetStats()
+// A scope that walks several nodes per call counts them in "<name> Nodes"
+static uint64_t GetNodeCount(const std::vector<InstrumentValue> &values, const std::vector<InstrumentValue> &flushed, const char *name)
 {
-	return s_Stats;
+	const std::string counter = std::format("{} Nodes", name);
+
+	for (size_t i = 0; i < values.size(); i++)
+		if (values[i].Kind == InstrumentKind::Counter && counter == values[i].Name)
+			return values[i].Ticks - (i < flushed.size() ? flushed[i].Ticks : 0);
+
+	return 0;
 }
 
-Timer::Timer(std::string &&name)
-	: m_Name(name), m_Start(std::chrono::high_resolution_clock::now())
+void Stats::FlushTimers()
 {
+	std::vector<InstrumentValue> values = Instrumentation::Snapshot();
+
+	std::lock_guard lock(s_Mutex);
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		const InstrumentValue &value = values[i];
+		const uint64_t previous = i < s_Flushed.size() ? s_Flushed[i].Ticks : 0;
+		const uint64_t previousCount = i < s_Flushed.size() ? s_Flushed[i].Count : 0;
+
+		if (value.Count == previousCount)
+			continue;
+
+		if (value.Kind == InstrumentKind::Timer)
+		{
+			s_Stats[value.Name] = std::format("{}: {:.3f} ms", value.Name, Instrumentation::TicksToNanoseconds(value.Ticks - previous) / 1e6);
+
+			PerfValues perf = value.Perf;
+			if (i < s_Flushed.size())
+				for (size_t event = 0; event < perf.size(); event++)
+					perf[event] -= s_Flushed[i].Perf[event];
+
+			if (perf[(size_t)PerfEvent::Cycles] != 0)
+			{
+				const uint64_t nodes = GetNodeCount(values, s_Flushed, value.Name);
+				s_Stats[std::format("{} Counters", value.Name)] = nodes == 0
+					? FormatPerfValues(value.Name, perf, value.Count - previousCount, "call")
+					: FormatPerfValues(value.Name, perf, nodes, "node");
+			}
+		}
+		else
+			s_Stats[value.Name] = std::format("{}: {}", value.Name, value.Ticks - previous);
+	}
+	s_Flushed = std::move(values);
+
+	if (const uint32_t threads = Instrumentation::GetPerfUnavailableThreads(); threads != 0)
+		s_Stats["Perf Counters"] = std::format("Perf Counters: not available on {} threads, their scopes are only timed", threads);
 }
 
-Timer::~Timer()
+std::map<std::string, std::string> Stats::GetStats()
 {
-	Stats::AddMeasurement(m_Name, std::chrono::high_resolution_clock::now() - m_Start);
+	std::lock_guard lock(s_Mutex);
+	return s_Stats;
 }
 
 void ThrowError(std::source_location location, const char *message)
 {
-	throw std::exception(
+	throw std::runtime_error(
 		std::format(
 			"Assertion failed at {}({}:{}): {}: {}", location.file_name(),
 			location.line(), location.column(), location.function_name(), message
-		).c_str()
+		)
 	);
 }
 
-}
\ No newline at end of file
+}
@@ -3,8 +3,12 @@
 #include <chrono>
 #include <format>
 #include <map>
+#include <mutex>
 #include <source_location>
 #include <string>
+#include <vector>
+
+#include "Instrumentation.h"
 
 namespace Checkers
 {
@@ -15,35 +19,28 @@ public:
 	template<typename... Args>
 	static void AddStat(std::string statName, std::string &&format, Args... args);
 
-	static void AddMeasurement(const std::string &timer, std::chrono::nanoseconds measurement);
-
 	static void Clear();
+
+	// Turns the instrument totals since the previous flush into stats
 	static void FlushTimers();
 
-	static const std::map<std::string, std::string> &GetStats();
+	// Copy, so that the UI thread can iterate while the game thread adds stats
+	static std::map<std::string, std::string> GetStats();
 
 private:
+	static std::mutex s_Mutex;
 	static std::map<std::string, std::string> s_Stats;
-	static std::map<std::string, std::chrono::nanoseconds> s_Measurements;
+	static std::vector<InstrumentValue> s_Flushed;
 };
 
 template<typename... Args>
 void Stats::AddStat(std::string statName, std::string &&format, Args... args)
 {
-	s_Stats[statName] = std::vformat(format, std::make_format_args(args...));
-}
+	std::string stat = std::vformat(format, std::make_format_args(args...));
 
-class Timer
-{
-public:
-	Timer(std::string &&name);
-	~Timer();
-
-private:
-	std::string m_Name;
-
-	std::chrono::time_point<std::chrono::high_resolution_clock> m_Start;
-};
+	std::lock_guard lock(s_Mutex);
+	s_Stats[statName] = std::move(stat);
+}
 
 void ThrowError(std::source_location location, const char *message);
 
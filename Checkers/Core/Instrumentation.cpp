@@ -0,0 +1,192 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+#include "Instrumentation.h"
+
+namespace Checkers
+{
+
+struct InstrumentInfo
+{
+	const char *Name;
+	InstrumentKind Kind;
+};
+
+static InstrumentInfo s_Instruments[Instrumentation::MaxInstruments];
+static std::atomic<instrument_id> s_InstrumentCount = 0;
+
+std::atomic<Instrumentation::ThreadSlots *> &Instrumentation::GetSlotsHead()
+{
+	static std::atomic<Instrumentation::ThreadSlots *> head = nullptr;
+	return head;
+}
+
+static std::mutex &GetRegisterMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+// Reference point for converting ticks to nanoseconds, the ratio gets more precise as time passes
+struct TickCalibration
+{
+	uint64_t Ticks = Instrumentation::GetTicks();
+	std::chrono::steady_clock::time_point Time = std::chrono::steady_clock::now();
+};
+
+static const TickCalibration &GetCalibration()
+{
+	static TickCalibration calibration;
+	return calibration;
+}
+
+static double GetNanosecondsPerTick()
+{
+#ifdef CHECKERS_HAS_TSC
+	const TickCalibration &calibration = GetCalibration();
+
+	const uint64_t ticks = Instrumentation::GetTicks() - calibration.Ticks;
+	const double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - calibration.Time).count();
+
+	return ticks == 0 ? 1.0 : nanoseconds / ticks;
+#else
+	return 1.0;
+#endif
+}
+
+instrument_id Instrumentation::Register(const char *name, InstrumentKind kind)
+{
+	GetCalibration();
+
+	std::lock_guard lock(GetRegisterMutex());
+
+	const instrument_id count = s_InstrumentCount.load(std::memory_order_relaxed);
+	for (instrument_id id = 0; id < count; id++)
+		if (std::string_view(s_Instruments[id].Name) == name && s_Instruments[id].Kind == kind)
+			return id;
+
+	assert(count < MaxInstruments);
+
+	s_Instruments[count] = { name, kind };
+	s_InstrumentCount.store(count + 1, std::memory_order_release);
+
+	return count;
+}
+
+static PerfCounters &GetThreadPerfCounters()
+{
+	thread_local std::unique_ptr<PerfCounters> counters = std::make_unique<PerfCounters>();
+	return *counters;
+}
+
+PerfValues Instrumentation::ReadPerfCounters()
+{
+	PerfCounters &counters = GetThreadPerfCounters();
+
+	// EnablePerfCounters probed only its own thread, the others find out here on their first scope
+	thread_local bool reported = false;
+	if (!reported && !counters.IsAvailable())
+	{
+		reported = true;
+		s_PerfUnavailableThreads++;
+		std::cerr << "Hardware performance counters are not available on a thread, its scopes are only timed" << std::endl;
+	}
+
+	return counters.Read();
+}
+
+uint32_t Instrumentation::GetPerfUnavailableThreads()
+{
+	return s_PerfUnavailableThreads;
+}
+
+bool Instrumentation::EnablePerfCounters()
+{
+	if (!GetThreadPerfCounters().IsAvailable())
+		return false;
+
+	s_PerfEnabled.store(true, std::memory_order_relaxed);
+	return true;
+}
+
+void Instrumentation::DisablePerfCounters()
+{
+	s_PerfEnabled.store(false, std::memory_order_relaxed);
+}
+
+void Instrumentation::AddPerfCounters(instrument_id id, const PerfValues &start, const PerfValues &end)
+{
+	ThreadSlots &slots = GetThreadSlots();
+
+	for (size_t event = 0; event < (size_t)PerfEvent::Count; event++)
+	{
+		std::atomic<uint64_t> &value = slots.Perf[id][event];
+		value.store(value.load(std::memory_order_relaxed) + end[event] - start[event], std::memory_order_relaxed);
+	}
+}
+
+uint64_t Instrumentation::TicksToNanoseconds(uint64_t ticks)
+{
+	return ticks * GetNanosecondsPerTick();
+}
+
+uint64_t Instrumentation::NanosecondsToTicks(uint64_t nanoseconds)
+{
+	return nanoseconds / GetNanosecondsPerTick();
+}
+
+std::vector<InstrumentValue> Instrumentation::Snapshot()
+{
+	const instrument_id count = s_InstrumentCount.load(std::memory_order_acquire);
+	const double nanosecondsPerTick = GetNanosecondsPerTick();
+
+	std::vector<InstrumentValue> values(count);
+	for (instrument_id id = 0; id < count; id++)
+		values[id] = { s_Instruments[id].Name, s_Instruments[id].Kind, 0, 0, 0, {} };
+
+	for (ThreadSlots *slots = GetSlotsHead().load(std::memory_order_acquire); slots != nullptr; slots = slots->Next)
+		for (instrument_id id = 0; id < count; id++)
+		{
+			values[id].Ticks += slots->Values[id].load(std::memory_order_relaxed);
+			values[id].Count += slots->Counts[id].load(std::memory_order_relaxed);
+
+			for (size_t event = 0; event < (size_t)PerfEvent::Count; event++)
+				values[id].Perf[event] += slots->Perf[id][event].load(std::memory_order_relaxed);
+		}
+
+	for (InstrumentValue &value : values)
+		value.Value = value.Kind == InstrumentKind::Timer ? (uint64_t)(value.Ticks * nanosecondsPerTick) : value.Ticks;
+
+	return values;
+}
+
+Instrumentation::ThreadSlotsHandle::ThreadSlotsHandle()
+{
+	std::atomic<ThreadSlots *> &head = GetSlotsHead();
+
+	for (ThreadSlots *slots = head.load(std::memory_order_acquire); slots != nullptr; slots = slots->Next)
+	{
+		bool inUse = false;
+		if (slots->InUse.compare_exchange_strong(inUse, true))
+		{
+			Slots = slots;
+			return;
+		}
+	}
+
+	// Slots are never freed, so readers can walk the list without locking
+	Slots = new ThreadSlots();
+	Slots->InUse = true;
+	Slots->Next = head.load(std::memory_order_relaxed);
+	while (!head.compare_exchange_weak(Slots->Next, Slots, std::memory_order_release, std::memory_order_relaxed));
+}
+
+Instrumentation::ThreadSlotsHandle::~ThreadSlotsHandle()
+{
+	Slots->InUse.store(false, std::memory_order_release);
+}
+
+}
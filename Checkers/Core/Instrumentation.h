@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PerfCounters.h"
+#include "Trace.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define CHECKERS_HAS_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CHECKERS_HAS_TSC
+#endif
+
+namespace Checkers
+{
+
+using instrument_id = uint32_t;
+
+enum class InstrumentKind
+{
+	Timer,
+	Counter
+};
+
+struct InstrumentValue
+{
+	const char *Name;
+	InstrumentKind Kind;
+
+	// Nanoseconds for timers
+	uint64_t Value;
+	uint64_t Count;
+
+	// Total before conversion, ticks for timers
+	// The calibration changes between snapshots, so a delta is taken in ticks and converted afterwards
+	uint64_t Ticks;
+
+	// Hardware events inside the scope of a timer, zero unless perf counters are enabled
+	PerfValues Perf;
+};
+
+// Registry of named timers and counters
+// Every thread writes to its own slots without synchronization, readers sum the slots of all threads
+class Instrumentation
+{
+public:
+	static constexpr size_t MaxInstruments = 128;
+
+	// Called once per instrument during static initialization (see Instrument)
+	static instrument_id Register(const char *name, InstrumentKind kind);
+
+	static void Add(instrument_id id, uint64_t value)
+	{
+		ThreadSlots &slots = GetThreadSlots();
+
+		// Single writer per slot, relaxed load and store avoid a locked instruction
+		slots.Values[id].store(slots.Values[id].load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		slots.Counts[id].store(slots.Counts[id].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// Timestamp used by timers, the time stamp counter where available
+	static uint64_t GetTicks()
+	{
+#ifdef CHECKERS_HAS_TSC
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// Hardware counters per timer scope, a pair of syscalls per scope so only for profiling
+	// Returns false and stays disabled when perf events aren't available to the calling thread
+	// Other threads open their counters on first use, one that fails is reported and its scopes are only timed
+	static bool EnablePerfCounters();
+	static void DisablePerfCounters();
+
+	static bool IsPerfEnabled()
+	{
+		return s_PerfEnabled.load(std::memory_order_relaxed);
+	}
+
+	// Threads that timed scopes with perf enabled but couldn't open their counters
+	static uint32_t GetPerfUnavailableThreads();
+
+	// Counters of the calling thread, opened on first use
+	static PerfValues ReadPerfCounters();
+	static void AddPerfCounters(instrument_id id, const PerfValues &start, const PerfValues &end);
+
+	static uint64_t TicksToNanoseconds(uint64_t ticks);
+	static uint64_t NanosecondsToTicks(uint64_t nanoseconds);
+
+	// Totals since start of every registered instrument, lock-free and safe to call from any thread
+	static std::vector<InstrumentValue> Snapshot();
+
+private:
+	struct ThreadSlots
+	{
+		std::atomic<uint64_t> Values[MaxInstruments] = {};
+		std::atomic<uint64_t> Counts[MaxInstruments] = {};
+		std::atomic<uint64_t> Perf[MaxInstruments][(size_t)PerfEvent::Count] = {};
+
+		// Slots of exited threads are reused, their totals stay
+		std::atomic<bool> InUse = false;
+		ThreadSlots *Next = nullptr;
+	};
+
+	struct ThreadSlotsHandle
+	{
+		ThreadSlotsHandle();
+		~ThreadSlotsHandle();
+
+		ThreadSlots *Slots;
+	};
+
+	static inline std::atomic<bool> s_PerfEnabled = false;
+	static inline std::atomic<uint32_t> s_PerfUnavailableThreads = 0;
+
+	static std::atomic<ThreadSlots *> &GetSlotsHead();
+
+	static ThreadSlots &GetThreadSlots()
+	{
+		thread_local ThreadSlotsHandle handle;
+		return *handle.Slots;
+	}
+};
+
+template<size_t N>
+struct InstrumentName
+{
+	constexpr InstrumentName(const char (&name)[N])
+	{
+		std::copy_n(name, N, Value);
+	}
+
+	char Value[N];
+};
+
+// One registry entry per distinct name, registered before main runs
+template<InstrumentName Name, InstrumentKind Kind>
+struct Instrument
+{
+	static inline const instrument_id Id = Instrumentation::Register(Name.Value, Kind);
+};
+
+template<InstrumentName Name>
+class Counter
+{
+public:
+	static void Add(uint64_t value = 1)
+	{
+		Instrumentation::Add(Instrument<Name, InstrumentKind::Counter>::Id, value);
+	}
+};
+
+// Measures the scope it lives in, compiled out without CHECKERS_ENABLE_TIMERS
+// While a trace is recorded the scope also becomes a trace event
+template<InstrumentName Name>
+class Timer
+{
+public:
+#ifdef CHECKERS_ENABLE_TIMERS
+	Timer()
+	{
+		// Counters are read outside of the timed interval so the syscall doesn't show up in the time
+		if (Instrumentation::IsPerfEnabled()) [[unlikely]]
+		{
+			m_Perf = true;
+			m_PerfStart = Instrumentation::ReadPerfCounters();
+		}
+
+		m_Start = Instrumentation::GetTicks();
+	}
+
+	~Timer()
+	{
+		const uint64_t end = Instrumentation::GetTicks();
+		Instrumentation::Add(Instrument<Name, InstrumentKind::Timer>::Id, end - m_Start);
+
+		if (m_Perf) [[unlikely]]
+			Instrumentation::AddPerfCounters(Instrument<Name, InstrumentKind::Timer>::Id, m_PerfStart, Instrumentation::ReadPerfCounters());
+
+#ifdef CHECKERS_ENABLE_TRACING
+		if (Trace::IsEnabled())
+			Trace::AddEvent(Name.Value, m_Start, end);
+#endif
+	}
+
+	static void Add(std::chrono::nanoseconds duration)
+	{
+		Instrumentation::Add(Instrument<Name, InstrumentKind::Timer>::Id, Instrumentation::NanosecondsToTicks(duration.count()));
+	}
+
+private:
+	uint64_t m_Start;
+
+	bool m_Perf = false;
+	PerfValues m_PerfStart;
+#else
+	static void Add(std::chrono::nanoseconds duration)
+	{
+	}
+#endif
+};
+
+}
@@ -0,0 +1,150 @@
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Checkers
+{
+
+#ifdef __linux__
+
+static int OpenEvent(PerfEvent event, int groupFd)
+{
+	perf_event_attr attr = {};
+	attr.size = sizeof(attr);
+	attr.disabled = groupFd == -1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP;
+
+	switch (event)
+	{
+	case PerfEvent::Cycles:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case PerfEvent::Instructions:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case PerfEvent::L1DMisses:
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	case PerfEvent::LLCMisses:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		break;
+	case PerfEvent::BranchMisses:
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	case PerfEvent::DTLBMisses:
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	default:
+		return -1;
+	}
+
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+PerfCounters::PerfCounters()
+{
+	m_Fds.fill(-1);
+	m_GroupIndex.fill(-1);
+
+	// The first event that opens leads the group, so that all of them are read at once
+	for (int i = 0; i < (int)PerfEvent::Count; i++)
+	{
+		int fd = OpenEvent((PerfEvent)i, m_LeaderFd);
+		if (fd == -1)
+			continue;
+
+		if (m_LeaderFd == -1)
+			m_LeaderFd = fd;
+
+		m_Fds[i] = fd;
+		m_GroupIndex[i] = m_GroupSize++;
+	}
+
+	if (m_LeaderFd != -1)
+	{
+		ioctl(m_LeaderFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(m_LeaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+}
+
+PerfCounters::~PerfCounters()
+{
+	for (int fd : m_Fds)
+		if (fd != -1)
+			close(fd);
+}
+
+PerfValues PerfCounters::Read() const
+{
+	PerfValues values = {};
+	if (m_LeaderFd == -1)
+		return values;
+
+	uint64_t buffer[1 + (size_t)PerfEvent::Count];
+	if (read(m_LeaderFd, buffer, sizeof(buffer)) <= 0)
+		return values;
+
+	for (int i = 0; i < (int)PerfEvent::Count; i++)
+		if (m_GroupIndex[i] != -1)
+			values[i] = buffer[1 + m_GroupIndex[i]];
+
+	return values;
+}
+
+#else
+
+PerfCounters::PerfCounters()
+{
+	m_Fds.fill(-1);
+	m_GroupIndex.fill(-1);
+}
+
+PerfCounters::~PerfCounters()
+{
+}
+
+PerfValues PerfCounters::Read() const
+{
+	return {};
+}
+
+#endif
+
+bool PerfCounters::IsAvailable() const
+{
+	return m_LeaderFd != -1;
+}
+
+bool PerfCounters::IsAvailable(PerfEvent event) const
+{
+	return m_Fds[(size_t)event] != -1;
+}
+
+const char *PerfCounters::GetName(PerfEvent event)
+{
+	switch (event)
+	{
+	case PerfEvent::Cycles: return "cycles";
+	case PerfEvent::Instructions: return "instructions";
+	case PerfEvent::L1DMisses: return "L1D misses";
+	case PerfEvent::LLCMisses: return "LLC misses";
+	case PerfEvent::BranchMisses: return "branch misses";
+	case PerfEvent::DTLBMisses: return "dTLB misses";
+	default: return "unknown";
+	}
+}
+
+}
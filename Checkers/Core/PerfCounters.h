@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Checkers
+{
+
+enum class PerfEvent
+{
+	Cycles,
+	Instructions,
+	L1DMisses,
+	LLCMisses,
+	BranchMisses,
+	DTLBMisses,
+	Count
+};
+
+using PerfValues = std::array<uint64_t, (size_t)PerfEvent::Count>;
+
+// Hardware counters of the calling thread (Linux perf_event_open)
+// Events the kernel doesn't permit or the CPU doesn't have read as 0, on other platforms nothing is available
+class PerfCounters
+{
+public:
+	PerfCounters();
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters &) = delete;
+	PerfCounters &operator=(const PerfCounters &) = delete;
+
+	bool IsAvailable() const;
+	bool IsAvailable(PerfEvent event) const;
+
+	// Counters run from construction, Read returns the totals since then with a single syscall
+	PerfValues Read() const;
+
+	static const char *GetName(PerfEvent event);
+
+private:
+	int m_LeaderFd = -1;
+	std::array<int, (size_t)PerfEvent::Count> m_Fds;
+
+	// Position of every opened event in the group read
+	std::array<int, (size_t)PerfEvent::Count> m_GroupIndex;
+	int m_GroupSize = 0;
+};
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+// Code shared between the host and the device (Position, generators) is written
+// against this header so that it also compiles without the CUDA toolkit
+
+#ifdef __CUDACC__
+
+#include <cuda.h>
+#include <cuda_runtime.h>
+
+#ifdef __CUDA_ARCH__
+
+#include <cuda/std/bit>
+#include <cuda/std/cassert>
+#include <cuda/std/type_traits>
+
+namespace stl = cuda::std;
+
+#define CONSTANT __constant__
+
+#endif
+
+#else
+
+#ifndef __host__
+#define __host__
+#endif
+
+#ifndef __device__
+#define __device__
+#endif
+
+#ifndef __inline__
+#define __inline__ inline
+#endif
+
+#endif
+
+#ifndef __CUDA_ARCH__
+
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <type_traits>
+#include <utility>
+
+namespace stl = std;
+
+#define CONSTANT
+
+#endif
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+namespace Checkers
+{
+
+// Little endian fields and LEB128 varints of the binary file formats
+
+inline void WriteUint32(std::string &out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		out.push_back((char)(value >> (8 * i)));
+}
+
+inline void WriteUint64(std::string &out, uint64_t value)
+{
+	WriteUint32(out, (uint32_t)value);
+	WriteUint32(out, (uint32_t)(value >> 32));
+}
+
+inline uint32_t ReadUint32(std::span<const uint8_t> data, size_t offset)
+{
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++)
+		value |= (uint32_t)data[offset + i] << (8 * i);
+	return value;
+}
+
+inline uint64_t ReadUint64(std::span<const uint8_t> data, size_t offset)
+{
+	return ReadUint32(data, offset) | (uint64_t)ReadUint32(data, offset + 4) << 32;
+}
+
+inline void WriteVarint(std::string &out, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((char)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((char)value);
+}
+
+inline uint64_t ReadVarint(std::span<const uint8_t> data, size_t &offset)
+{
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (offset == data.size())
+			throw std::runtime_error("Truncated payload");
+
+		const uint8_t byte = data[offset++];
+		value |= (uint64_t)(byte & 0x7f) << shift;
+
+		if ((byte & 0x80) == 0)
+			return value;
+	}
+
+	throw std::runtime_error("Invalid varint in payload");
+}
+
+// CRC-32 (IEEE), pass the previous result as crc to continue a checksum
+inline uint32_t Crc32(std::span<const uint8_t> data, uint32_t crc = 0)
+{
+	static constexpr std::array<uint32_t, 256> table = [] {
+		std::array<uint32_t, 256> table = {};
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; bit++)
+				value = (value & 1) ? 0xedb88320u ^ (value >> 1) : value >> 1;
+			table[i] = value;
+		}
+		return table;
+	}();
+
+	crc = ~crc;
+	for (uint8_t byte : data)
+		crc = table[(crc ^ byte) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+}
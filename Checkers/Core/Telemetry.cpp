@@ -0,0 +1,119 @@
+#include "Telemetry.h"
+
+namespace Checkers
+{
+
+std::mutex Telemetry::s_Mutex;
+std::condition_variable Telemetry::s_DataReady;
+std::string Telemetry::s_Pending = {};
+bool Telemetry::s_Closing = false;
+
+FILE *Telemetry::s_File = nullptr;
+std::function<void(std::string_view line)> Telemetry::s_Sink = {};
+std::thread Telemetry::s_Writer;
+
+bool Telemetry::Open(const std::string &path)
+{
+	Close();
+
+	FILE *file = path == "-" ? stdout : std::fopen(path.c_str(), "a");
+	if (file == nullptr)
+		return false;
+
+	Start(file, {});
+	return true;
+}
+
+void Telemetry::Open(std::function<void(std::string_view line)> sink)
+{
+	Close();
+	Start(nullptr, std::move(sink));
+}
+
+void Telemetry::Start(FILE *file, std::function<void(std::string_view line)> sink)
+{
+	{
+		std::lock_guard lock(s_Mutex);
+		s_File = file;
+		s_Sink = std::move(sink);
+		s_Closing = false;
+	}
+	s_Writer = std::thread(Telemetry::WriterLoop);
+}
+
+void Telemetry::Close()
+{
+	if (!s_Writer.joinable())
+		return;
+
+	{
+		std::lock_guard lock(s_Mutex);
+		s_Closing = true;
+	}
+	s_DataReady.notify_one();
+	s_Writer.join();
+
+	// Writes after this are dropped, they check the state under the lock
+	std::lock_guard lock(s_Mutex);
+	if (s_File != nullptr && s_File != stdout)
+		std::fclose(s_File);
+	s_File = nullptr;
+	s_Sink = {};
+}
+
+bool Telemetry::IsEnabled()
+{
+	std::lock_guard lock(s_Mutex);
+	return (s_File != nullptr || s_Sink) && !s_Closing;
+}
+
+void Telemetry::Write(std::string_view line)
+{
+	{
+		std::lock_guard lock(s_Mutex);
+		if ((s_File == nullptr && !s_Sink) || s_Closing)
+			return;
+
+		s_Pending.append(line);
+		s_Pending.push_back('\n');
+	}
+	s_DataReady.notify_one();
+}
+
+void Telemetry::WriterLoop()
+{
+	// Double buffered, producers fill s_Pending while the previous buffer is written out
+	std::string buffer;
+
+	std::unique_lock lock(s_Mutex);
+	while (true)
+	{
+		s_DataReady.wait(lock, [] { return s_Closing || !s_Pending.empty(); });
+
+		buffer.swap(s_Pending);
+		const bool closing = s_Closing;
+		lock.unlock();
+
+		if (!buffer.empty() && s_File != nullptr)
+		{
+			std::fwrite(buffer.data(), 1, buffer.size(), s_File);
+			std::fflush(s_File);
+		}
+		else if (!buffer.empty())
+		{
+			const std::string_view lines = buffer;
+			for (size_t begin = 0, end; begin < lines.size(); begin = end + 1)
+			{
+				end = lines.find('\n', begin);
+				s_Sink(lines.substr(begin, end - begin));
+			}
+		}
+		buffer.clear();
+
+		lock.lock();
+		if (closing && s_Pending.empty())
+			return;
+	}
+}
+
+}
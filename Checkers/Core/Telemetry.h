@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace Checkers
+{
+
+// Stream of JSON lines (one per move) for monitoring
+// Write only appends to an in-memory buffer, a background thread does the I/O
+class Telemetry
+{
+public:
+	// Path "-" writes to stdout, returns false if the file can't be opened
+	static bool Open(const std::string &path);
+
+	// Every line is passed to sink without its newline, on the writer thread
+	// For tools whose stdout is a protocol, so that they write telemetry with the rest of their output
+	static void Open(std::function<void(std::string_view line)> sink);
+
+	static void Close();
+
+	static bool IsEnabled();
+
+	// Appends a newline
+	static void Write(std::string_view line);
+
+private:
+	static std::mutex s_Mutex;
+	static std::condition_variable s_DataReady;
+	static std::string s_Pending;
+	static bool s_Closing;
+
+	static FILE *s_File;
+	static std::function<void(std::string_view line)> s_Sink;
+	static std::thread s_Writer;
+
+	static void Start(FILE *file, std::function<void(std::string_view line)> sink);
+	static void WriterLoop();
+};
+
+}
@@ -0,0 +1,192 @@
+#include <format>
+#include <fstream>
+#include <mutex>
+
+#include "Instrumentation.h"
+#include "Trace.h"
+
+namespace Checkers
+{
+
+struct TraceEvent
+{
+	const char *Name;
+	uint64_t Begin, End;
+
+	// 0 for events nested in the thread's scopes
+	uint64_t AsyncId;
+};
+
+// Single producer (the owning thread), single consumer (Flush under s_FlushMutex)
+// When the consumer falls behind new events are dropped rather than overwriting unread ones
+struct TraceBuffer
+{
+	static constexpr size_t Capacity = 1 << 18;
+
+	TraceEvent Events[Capacity];
+	std::atomic<size_t> Head = 0, Tail = 0;
+	std::atomic<uint64_t> Dropped = 0;
+
+	uint32_t ThreadId = 0;
+	std::atomic<const char *> ThreadName = nullptr;
+	bool NameWritten = false;
+
+	std::atomic<bool> InUse = false;
+	TraceBuffer *Next = nullptr;
+};
+
+std::atomic<bool> Trace::s_Enabled = false;
+
+static std::atomic<TraceBuffer *> s_Buffers = nullptr;
+static std::atomic<uint32_t> s_ThreadCount = 0;
+
+static std::mutex s_FlushMutex;
+static std::ofstream s_File;
+static uint64_t s_StartTicks = 0;
+
+struct TraceBufferHandle
+{
+	TraceBufferHandle()
+	{
+		for (TraceBuffer *buffer = s_Buffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->Next)
+		{
+			bool inUse = false;
+			if (buffer->InUse.compare_exchange_strong(inUse, true))
+			{
+				Buffer = buffer;
+				return;
+			}
+		}
+
+		// Buffers are never freed, Flush walks the list without locking out the producers
+		Buffer = new TraceBuffer();
+		Buffer->InUse = true;
+		Buffer->ThreadId = ++s_ThreadCount;
+		Buffer->Next = s_Buffers.load(std::memory_order_relaxed);
+		while (!s_Buffers.compare_exchange_weak(Buffer->Next, Buffer, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	~TraceBufferHandle()
+	{
+		Buffer->InUse.store(false, std::memory_order_release);
+	}
+
+	TraceBuffer *Buffer;
+};
+
+static TraceBuffer &GetThreadBuffer()
+{
+	thread_local TraceBufferHandle handle;
+	return *handle.Buffer;
+}
+
+bool Trace::Start(const std::string &path)
+{
+	std::lock_guard lock(s_FlushMutex);
+
+	s_File.open(path, std::ios::out | std::ios::trunc);
+	if (!s_File)
+		return false;
+
+	// JSON array format, the closing bracket is optional so events can be appended as they come
+	s_File << "[\n";
+	s_StartTicks = Instrumentation::GetTicks();
+	s_Enabled.store(true, std::memory_order_relaxed);
+
+	return true;
+}
+
+void Trace::Stop()
+{
+	if (!IsEnabled())
+		return;
+
+	s_Enabled.store(false, std::memory_order_relaxed);
+	Flush();
+
+	std::lock_guard lock(s_FlushMutex);
+	s_File.close();
+}
+
+void Trace::AddEvent(const char *name, uint64_t beginTicks, uint64_t endTicks)
+{
+	AddAsyncEvent(name, 0, beginTicks, endTicks);
+}
+
+void Trace::AddAsyncEvent(const char *name, uint64_t id, uint64_t beginTicks, uint64_t endTicks)
+{
+	TraceBuffer &buffer = GetThreadBuffer();
+
+	const size_t head = buffer.Head.load(std::memory_order_relaxed);
+	if (head - buffer.Tail.load(std::memory_order_acquire) == TraceBuffer::Capacity)
+	{
+		buffer.Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	buffer.Events[head % TraceBuffer::Capacity] = { name, beginTicks, endTicks, id };
+	buffer.Head.store(head + 1, std::memory_order_release);
+}
+
+void Trace::SetThreadName(const char *name)
+{
+	GetThreadBuffer().ThreadName.store(name, std::memory_order_relaxed);
+}
+
+void Trace::Flush()
+{
+	std::lock_guard lock(s_FlushMutex);
+
+	if (!s_File.is_open())
+		return;
+
+	auto toMicroseconds = [](uint64_t ticks) {
+		return ticks < s_StartTicks ? 0.0 : Instrumentation::TicksToNanoseconds(ticks - s_StartTicks) / 1000.0;
+	};
+
+	for (TraceBuffer *buffer = s_Buffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->Next)
+	{
+		const char *threadName = buffer->ThreadName.load(std::memory_order_relaxed);
+		if (threadName != nullptr && !buffer->NameWritten)
+		{
+			s_File << std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}},\n", buffer->ThreadId, threadName);
+			buffer->NameWritten = true;
+		}
+
+		const size_t head = buffer->Head.load(std::memory_order_acquire);
+		size_t tail = buffer->Tail.load(std::memory_order_relaxed);
+
+		for (; tail != head; tail++)
+		{
+			const TraceEvent &event = buffer->Events[tail % TraceBuffer::Capacity];
+
+			// Events recorded before Start have no place on the timeline
+			if (event.Begin < s_StartTicks)
+				continue;
+
+			const double begin = toMicroseconds(event.Begin);
+			if (event.AsyncId == 0)
+				s_File << std::format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}},\n",
+					event.Name, buffer->ThreadId, begin, toMicroseconds(event.End) - begin
+				);
+			else
+				s_File << std::format(
+					"{{\"name\":\"{0}\",\"cat\":\"async\",\"ph\":\"b\",\"id\":{1},\"pid\":1,\"tid\":{2},\"ts\":{3:.3f}}},\n"
+					"{{\"name\":\"{0}\",\"cat\":\"async\",\"ph\":\"e\",\"id\":{1},\"pid\":1,\"tid\":{2},\"ts\":{4:.3f}}},\n",
+					event.Name, event.AsyncId, buffer->ThreadId, begin, toMicroseconds(event.End)
+				);
+		}
+
+		buffer->Tail.store(tail, std::memory_order_release);
+
+		const uint64_t dropped = buffer->Dropped.exchange(0, std::memory_order_relaxed);
+		if (dropped != 0)
+			s_File << std::format("{{\"name\":\"{} events dropped\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":{},\"ts\":{:.3f}}},\n",
+				dropped, buffer->ThreadId, toMicroseconds(Instrumentation::GetTicks())
+			);
+	}
+
+	s_File.flush();
+}
+
+}
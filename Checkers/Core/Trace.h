@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace Checkers
+{
+
+// Timeline of instrumented scopes in the Chrome trace event format (chrome://tracing, ui.perfetto.dev)
+// Every thread records into its own ring buffer, Flush appends the recorded events to the file
+class Trace
+{
+public:
+	// Starts recording, returns false if the file can't be created
+	static bool Start(const std::string &path);
+	static void Stop();
+
+	static bool IsEnabled()
+	{
+		return s_Enabled.load(std::memory_order_relaxed);
+	}
+
+	// Ticks as returned by Instrumentation::GetTicks
+	static void AddEvent(const char *name, uint64_t beginTicks, uint64_t endTicks);
+
+	// Interval that overlaps other events of the thread (e.g. an asynchronous simulation batch), shown on its own track
+	static void AddAsyncEvent(const char *name, uint64_t id, uint64_t beginTicks, uint64_t endTicks);
+
+	// Shown in place of the thread id, the name must outlive the trace
+	static void SetThreadName(const char *name);
+
+	// Writes events of all threads recorded since the previous flush
+	static void Flush();
+
+private:
+	static std::atomic<bool> s_Enabled;
+};
+
+}
@@ -1,175 +1,121 @@
-#include <bit>
 #include <format>
-#include <iostream>
 
 #include "Core/Core.h"
 
-#include "Controllers/ComputerController.h"
 #include "Controllers/PlayerController.h"
+#include "Controllers/SimulatorPool.h"
 #include "Game.h"
 
 namespace Checkers
 {
 
 Window *Game::s_Window = nullptr;
+std::unique_ptr<GameSession> Game::s_Session = nullptr;
+bool Game::s_WarmUp = false;
 
-Position Game::s_Position = StartingPosition;
-bool Game::s_Finished = false;
-
-ControllerType Game::s_BlackControllerType = ControllerType::PlayerController;
-ControllerType Game::s_WhiteControllerType = ControllerType::PlayerController;
-
-static ComputerController s_ComputerHostBlack(ControllerType::ComputerHostController, Simulator::CreateHost(), 1e9, std::chrono::seconds(1));
-static ComputerController s_ComputerHostWhite(ControllerType::ComputerHostController, Simulator::CreateHost(), 1e9, std::chrono::seconds(1));
-static ComputerController s_ComputerDeviceBlack(ControllerType::ComputerDeviceController, Simulator::CreateDevice(96, 64), 1e9, std::chrono::seconds(1), 96);
-static ComputerController s_ComputerDeviceWhite(ControllerType::ComputerDeviceController, Simulator::CreateDevice(24, 128), 1e9, std::chrono::seconds(1), 24);
-static PlayerController s_PlayerBlack;
-static PlayerController s_PlayerWhite;
-
-static Controller *s_ControllerBlack = &s_PlayerBlack;
-static Controller *s_ControllerWhite = &s_PlayerWhite;
-
-static std::thread s_GameThread;
-
-void Game::Init(Window *window)
+void Game::Init(Window *window, bool warmUp, TimeControl timeControl)
 {
 	s_Window = window;
+	s_WarmUp = warmUp;
+	s_Session = std::make_unique<GameSession>(Game::CreateController, ControllerType::PlayerController, ControllerType::PlayerController);
+	s_Session->SetOnMove(Game::OnMove);
+	s_Session->SetTimeControl(timeControl);
 }
 
 void Game::Start()
 {
-	s_Finished = false;
 	s_Window->SetTextOverlay(nullptr);
-	s_Position = StartingPosition;
-	s_GameThread = std::thread(Game::Run);
+	s_Session->Start();
+
+	if (s_WarmUp)
+		s_Session->WarmUp();
 }
 
 void Game::End()
 {
-	s_Finished = true;
-	s_ControllerBlack->CancelMove();
-	s_ControllerWhite->CancelMove();
-	s_GameThread.join();
+	s_Session->End();
 }
 
 ControllerType Game::GetBlackPlayerType()
 {
-	return s_BlackControllerType;
+	return s_Session->GetBlackPlayerType();
 }
 
 ControllerType Game::GetWhitePlayerType()
 {
-	return s_WhiteControllerType;
+	return s_Session->GetWhitePlayerType();
 }
 
 void Game::SelectBlackPlayer(ControllerType type)
 {
-	s_BlackControllerType = type;
-	s_ControllerBlack->CancelMove();
+	s_Session->SelectBlackPlayer(type);
+
+	if (s_WarmUp)
+		s_Session->WarmUp();
 }
 
 void Game::SelectWhitePlayer(ControllerType type)
 {
-	s_WhiteControllerType = type;
-	s_ControllerWhite->CancelMove();
+	s_Session->SelectWhitePlayer(type);
+
+	if (s_WarmUp)
+		s_Session->WarmUp();
 }
 
-Position &Game::GetPosition()
+Position Game::GetPosition()
 {
-	return s_Position;
+	return s_Session->GetState().Position;
 }
 
 void Game::HandleClick(float x, float y)
 {
-	if (s_Finished) return;
-
-	if (s_Position.BlackTurn)
-		s_ControllerBlack->OnClick(x, y);
-	else
-		s_ControllerWhite->OnClick(x, y);
+	s_Session->HandleClick(x, y);
 }
 
-void Game::Run()
+std::unique_ptr<Controller> Game::CreateController(ControllerType type, bool black)
 {
-	while (!s_Finished)
-	{
-		Position newPosition;
-		Controller *controller;
-		
-		do {
-			if (s_Position.BlackTurn)
-				ChangeBlackPlayer();
-			else
-				ChangeWhitePlayer();
-
-			controller = s_Position.BlackTurn ? s_ControllerBlack : s_ControllerWhite;
-
-			newPosition = controller->MakeMove(s_Position);
-
-			if (s_Finished) return;
-		} while (controller->GetControllerType() != (s_Position.BlackTurn ? s_BlackControllerType : s_WhiteControllerType));
+	if (type == ControllerType::PlayerController)
+		return std::make_unique<PlayerController>();
 
-		s_Position = newPosition;
-		Stats::FlushTimers();
-		s_Window->Refresh();
-
-		CheckFinished();
-		if (s_Finished) return;
-	}
+	return GameSession::CreateComputerController(type, black);
 }
 
-void Game::ChangeBlackPlayer()
+void Game::OnMove(const GameSession &session)
 {
-	if (s_ControllerBlack->GetControllerType() == s_BlackControllerType) return;
-
-	switch (s_BlackControllerType)
+	Stats::FlushTimers();
+	Trace::Flush();
+
+	for (const BatchingClientStats &client : SimulatorPool::GetClientStats())
+		Stats::AddStat(std::format("{} Pool", client.Name), "{} Simulator Share: {:.1f} %%, wait {:.2f} ms",
+			client.Name, client.Utilization * 100.0, client.AverageWait.count() / 1e3
+		);
+	s_Window->Refresh();
+
+	const SessionState state = session.GetState();
+
+	if (state.TimeControl.IsEnabled())
+		Stats::AddStat("Clock", "Clock: Black {:.1f} s, White {:.1f} s",
+			state.BlackClock.count() / 1e9, state.WhiteClock.count() / 1e9
+		);
+
+	if (state.MoveCount == 1)
+		Stats::AddStat("Startup Move", "Time to first move: {:.1f} ms ({:.1f} ms setup)",
+			state.FirstMoveTime.count() / 1e6, state.SetupTime.count() / 1e6
+		);
+	switch (state.Result)
 	{
-	case ControllerType::ComputerDeviceController:
-		s_ControllerBlack = &s_ComputerDeviceBlack;
-		break;
-	case ControllerType::ComputerHostController:
-		s_ControllerBlack = &s_ComputerHostBlack;
+	case GameResult::WhiteWin:
+		s_Window->SetTextOverlay("White won!");
 		break;
-	case ControllerType::PlayerController:
-		s_ControllerBlack = &s_PlayerBlack;
+	case GameResult::BlackWin:
+		s_Window->SetTextOverlay("Black won!");
 		break;
-	}
-}
-
-void Game::ChangeWhitePlayer()
-{
-	if (s_ControllerWhite->GetControllerType() == s_WhiteControllerType) return;
-
-	switch (s_WhiteControllerType)
-	{
-	case ControllerType::ComputerDeviceController:
-		s_ControllerWhite = &s_ComputerDeviceWhite;
-		break;
-	case ControllerType::ComputerHostController:
-		s_ControllerWhite = &s_ComputerHostWhite;
+	case GameResult::Draw:
+		s_Window->SetTextOverlay("Draw by 30 moves without captures!");
 		break;
-	case ControllerType::PlayerController:
-		s_ControllerWhite = &s_PlayerWhite;
+	default:
 		break;
 	}
 }
 
-void Game::CheckFinished()
-{
-	if (s_Position.HasLost())
-	{
-		s_Finished = true;
-		if (s_Position.BlackTurn)
-			s_Window->SetTextOverlay("White won!");
-		else
-			s_Window->SetTextOverlay("Black won!");
-	}
-
-	if (s_Position.IsDraw())
-	{
-		s_Finished = true;
-		s_Window->SetTextOverlay("Draw by 30 moves without captures!");
-	}
-}
-
 }
@@ -1,15 +1,20 @@
 #pragma once
 
+#include <memory>
+
 #include "Controllers/Controller.h"
+#include "GameSession.h"
 #include "Window.h"
 
 namespace Checkers
 {
 
+// The game of the window, a single session played on its own thread
 class Game
 {
 public:
-	static void Init(Window *window);
+	// With warmUp computer players are created and warmed up in the background as soon as they are selected
+	static void Init(Window *window, bool warmUp = false, TimeControl timeControl = {});
 	static void Start();
 	static void End();
 
@@ -19,23 +24,18 @@ public:
 	static void SelectBlackPlayer(ControllerType type);
 	static void SelectWhitePlayer(ControllerType type);
 
-	static Position &GetPosition();
+	// A copy, read by the renderer every frame while the game thread plays
+	static Position GetPosition();
 
 	static void HandleClick(float x, float y);
 
 private:
 	static Window *s_Window;
+	static std::unique_ptr<GameSession> s_Session;
+	static bool s_WarmUp;
 
-	static Position s_Position;
-	static bool s_Finished;
-
-	static ControllerType s_BlackControllerType;
-	static ControllerType s_WhiteControllerType;
-
-	static void Run();
-	static void ChangeBlackPlayer();
-	static void ChangeWhitePlayer();
-	static void CheckFinished();
+	static std::unique_ptr<Controller> CreateController(ControllerType type, bool black);
+	static void OnMove(const GameSession &session);
 };
 
 }
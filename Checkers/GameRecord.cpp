@@ -0,0 +1,482 @@
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <format>
+#include <stdexcept>
+
+#include "Core/Serialization.h"
+#include "GameRecord.h"
+
+namespace Checkers
+{
+
+Position GameRecord::Replay(std::vector<Move> &moves) const
+{
+	Position position = Start;
+
+	for (size_t i = 0; i < Moves.size(); i++)
+	{
+		if (position.HasLost() || position.IsDraw())
+			throw std::runtime_error(std::format("Move {} played after the end of the game", i + 1));
+
+		MoveGenerator::Generate(position, moves);
+		if (Moves[i] >= moves.size())
+			throw std::runtime_error(std::format("Move {} has index {} of {} legal moves", i + 1, Moves[i], moves.size()));
+
+		position = moves[Moves[i]].Position;
+	}
+
+	const bool lost = position.HasLost();
+
+	// The side to move ran out of time before playing
+	if (Termination == GameTermination::TimeForfeit)
+	{
+		if (lost || position.IsDraw() || Result != (position.BlackTurn ? GameResult::WhiteWin : GameResult::BlackWin))
+			throw std::runtime_error("Time forfeit doesn't match the final position");
+
+		return position;
+	}
+
+	if ((Result == GameResult::WhiteWin && !(lost && position.BlackTurn))
+		|| (Result == GameResult::BlackWin && !(lost && !position.BlackTurn))
+		|| (Result == GameResult::Draw && lost))
+		throw std::runtime_error("Result doesn't match the final position");
+
+	return position;
+}
+
+void BinaryRecord::Write(std::ostream &out, const GameRecord &record)
+{
+	const bool hasStats = !record.Stats.empty();
+
+	std::string payload;
+	payload.reserve(record.Moves.size() * (hasStats ? 8 : 1));
+
+	for (uint16_t move : record.Moves)
+		WriteVarint(payload, move);
+
+	if (hasStats)
+		for (const MoveStats &stats : record.Stats)
+		{
+			const uint16_t winRate = (uint16_t)std::lround(std::clamp(stats.WinRate, 0.0f, 1.0f) * 65535.0f);
+
+			WriteVarint(payload, stats.Simulations);
+			payload.push_back((char)winRate);
+			payload.push_back((char)(winRate >> 8));
+			WriteVarint(payload, stats.TimeMs);
+		}
+
+	std::string header;
+	header.reserve(HeaderSize);
+	WriteUint32(header, Magic);
+	header.push_back((char)Version);
+	header.push_back((char)(hasStats ? HasStats : 0));
+	header.push_back((char)record.Result);
+	header.push_back((char)record.Termination);
+	WriteUint32(header, record.Start.Black);
+	WriteUint32(header, record.Start.White);
+	WriteUint32(header, record.Start.Queens);
+	header.push_back((char)record.Start.SinceCapture);
+	header.push_back((char)record.Start.BlackTurn);
+	header.append(2, 0);
+	WriteUint32(header, record.Moves.size());
+	WriteUint32(header, payload.size());
+
+	out.write(header.data(), header.size());
+	out.write(payload.data(), payload.size());
+}
+
+size_t BinaryRecord::GetPayloadSize(std::span<const uint8_t> header)
+{
+	if (ReadUint32(header, 0) != Magic || header[4] != Version)
+		throw std::runtime_error("Not a game record or unsupported version");
+
+	const size_t size = ReadUint32(header, 28);
+	if (size > MaxPayloadSize)
+		throw std::runtime_error(std::format("Record payload of {} bytes exceeds the limit", size));
+
+	return size;
+}
+
+size_t BinaryRecord::GetSize(std::span<const uint8_t> data)
+{
+	if (data.size() < HeaderSize)
+		throw std::runtime_error("Truncated record header");
+
+	const size_t size = HeaderSize + GetPayloadSize(data);
+	if (data.size() < size)
+		throw std::runtime_error("Truncated record payload");
+
+	return size;
+}
+
+GameRecord BinaryRecord::Read(std::span<const uint8_t> data)
+{
+	const size_t size = GetSize(data);
+	data = data.first(size);
+
+	GameRecord record;
+
+	const uint8_t flags = data[5];
+	if (data[6] > (uint8_t)GameResult::Draw)
+		throw std::runtime_error("Invalid result in record header");
+	record.Result = (GameResult)data[6];
+
+	// Written as 0 before time forfeits were recorded
+	if (data[7] > (uint8_t)GameTermination::TimeForfeit)
+		throw std::runtime_error("Invalid termination in record header");
+	record.Termination = (GameTermination)data[7];
+
+	record.Start = Position{
+		ReadUint32(data, 8), ReadUint32(data, 12), ReadUint32(data, 16),
+		(int8_t)data[20], data[21] != 0
+	};
+
+	const uint32_t moveCount = ReadUint32(data, 24);
+	if (moveCount > size - HeaderSize)
+		throw std::runtime_error("Move count exceeds record payload");
+
+	size_t offset = HeaderSize;
+
+	record.Moves.resize(moveCount);
+	for (uint16_t &move : record.Moves)
+		move = ReadVarint(data, offset);
+
+	if (flags & HasStats)
+	{
+		record.Stats.resize(moveCount);
+		for (MoveStats &stats : record.Stats)
+		{
+			stats.Simulations = ReadVarint(data, offset);
+
+			if (offset + 2 > data.size())
+				throw std::runtime_error("Truncated record payload");
+			stats.WinRate = (data[offset] | (data[offset + 1] << 8)) / 65535.0f;
+			offset += 2;
+
+			stats.TimeMs = ReadVarint(data, offset);
+		}
+	}
+
+	if (offset != size)
+		throw std::runtime_error("Record payload size mismatch");
+
+	return record;
+}
+
+bool BinaryRecord::Read(std::istream &in, GameRecord &record)
+{
+	std::vector<uint8_t> buffer(HeaderSize);
+	if (!in.read((char *)buffer.data(), HeaderSize))
+	{
+		if (in.gcount() == 0)
+			return false;
+		throw std::runtime_error("Truncated record header");
+	}
+
+	buffer.resize(HeaderSize + GetPayloadSize(buffer));
+	if (!in.read((char *)buffer.data() + HeaderSize, buffer.size() - HeaderSize))
+		throw std::runtime_error("Truncated record payload");
+
+	record = Read(buffer);
+	return true;
+}
+
+static const char *GetResultString(GameResult result)
+{
+	switch (result)
+	{
+	case GameResult::WhiteWin: return "1-0";
+	case GameResult::BlackWin: return "0-1";
+	case GameResult::Draw: return "1/2-1/2";
+	default: return "*";
+	}
+}
+
+static std::string GetFen(const Position &position)
+{
+	auto pieces = [&](Bitboard board) {
+		std::string list;
+		while (board)
+		{
+			const int index = std::countr_zero(board);
+			board &= board - 1;
+
+			list += std::format("{}{}{}", list.empty() ? "" : ",", Board::HasBit(position.Queens, index) ? "K" : "", index + 1);
+		}
+		return list;
+	};
+
+	return std::format("{}:W{}:B{}", position.BlackTurn ? 'B' : 'W', pieces(position.White), pieces(position.Black));
+}
+
+std::string Pdn::Write(const GameRecord &record)
+{
+	std::string pdn;
+
+	for (const auto &[name, value] : record.Tags)
+		pdn += std::format("[{} \"{}\"]\n", name, value);
+	// FEN has no move counter, the moves since the last capture get a tag of their own
+	Position start = record.Start;
+	start.SinceCapture = 0;
+	if (start != StartingPosition)
+		pdn += std::format("[FEN \"{}\"]\n", GetFen(record.Start));
+	if (record.Start.SinceCapture != 0)
+		pdn += std::format("[SinceCapture \"{}\"]\n", record.Start.SinceCapture);
+	if (record.Termination == GameTermination::TimeForfeit)
+		pdn += "[Termination \"time forfeit\"]\n";
+	pdn += std::format("[Result \"{}\"]\n\n", GetResultString(record.Result));
+
+	std::vector<Move> moves;
+	Position position = record.Start;
+
+	std::string line;
+	for (size_t i = 0; i < record.Moves.size(); i++)
+	{
+		MoveGenerator::Generate(position, moves);
+		if (record.Moves[i] >= moves.size())
+			throw std::runtime_error(std::format("Move {} has index {} of {} legal moves", i + 1, record.Moves[i], moves.size()));
+
+		const Move &move = moves[record.Moves[i]];
+
+		std::string token = i % 2 == 0 ? std::format("{}. ", i / 2 + 1) : "";
+		for (int j = 0; j < move.Length; j++)
+			token += std::format("{}{}", j == 0 ? "" : move.IsCapture ? "x" : "-", move.Path[j] + 1);
+
+		if (line.size() + token.size() > 79)
+		{
+			pdn += line + "\n";
+			line.clear();
+		}
+		line += (line.empty() ? "" : " ") + token;
+
+		position = move.Position;
+	}
+
+	line += std::string(line.empty() ? "" : " ") + GetResultString(record.Result);
+	pdn += line + "\n\n";
+
+	return pdn;
+}
+
+static Position ParseFen(std::string_view fen)
+{
+	Position position = { Board::Empty, Board::Empty, Board::Empty, 0, false };
+
+	if (fen.empty() || (fen[0] != 'W' && fen[0] != 'B'))
+		throw std::runtime_error(std::format("Invalid FEN {}", fen));
+	position.BlackTurn = fen[0] == 'B';
+
+	Bitboard *pieces = nullptr;
+	for (size_t i = 1; i < fen.size();)
+	{
+		const char c = fen[i];
+		if (c == ':' && i + 1 < fen.size() && (fen[i + 1] == 'W' || fen[i + 1] == 'B'))
+		{
+			pieces = fen[i + 1] == 'W' ? &position.White : &position.Black;
+			i += 2;
+			continue;
+		}
+
+		if (c == ',' || c == ' ' || c == '.')
+		{
+			i++;
+			continue;
+		}
+
+		const bool queen = c == 'K';
+		if (queen)
+			i++;
+
+		size_t end = i;
+		while (end < fen.size() && std::isdigit((unsigned char)fen[end]))
+			end++;
+
+		const int square = end == i ? 0 : std::stoi(std::string(fen.substr(i, end - i)));
+		if (pieces == nullptr || square < 1 || square > 32)
+			throw std::runtime_error(std::format("Invalid FEN {}", fen));
+
+		*pieces |= Board::FromIndex(square - 1);
+		if (queen)
+			position.Queens |= Board::FromIndex(square - 1);
+
+		i = end;
+	}
+
+	if (position.Black & position.White)
+		throw std::runtime_error(std::format("Invalid FEN {}", fen));
+
+	return position;
+}
+
+static bool ParseResult(std::string_view token, GameResult &result)
+{
+	if (token == "1-0" || token == "2-0")
+		result = GameResult::WhiteWin;
+	else if (token == "0-1" || token == "0-2")
+		result = GameResult::BlackWin;
+	else if (token == "1/2-1/2" || token == "1-1")
+		result = GameResult::Draw;
+	else if (token == "*")
+		result = GameResult::Unfinished;
+	else
+		return false;
+
+	return true;
+}
+
+// Index of the move written as squares separated by '-' or 'x'
+static uint16_t ParseMove(std::string_view token, const Position &position, std::vector<Move> &moves)
+{
+	std::vector<int> squares;
+	for (size_t i = 0; i < token.size();)
+	{
+		size_t end = i;
+		while (end < token.size() && std::isdigit((unsigned char)token[end]))
+			end++;
+
+		if (end == i)
+			throw std::runtime_error(std::format("Invalid move {}", token));
+
+		squares.push_back(std::stoi(std::string(token.substr(i, end - i))) - 1);
+		i = end + 1;
+	}
+
+	if (squares.size() < 2)
+		throw std::runtime_error(std::format("Invalid move {}", token));
+
+	MoveGenerator::Generate(position, moves);
+
+	int found = -1;
+	for (size_t i = 0; i < moves.size(); i++)
+	{
+		const Move &move = moves[i];
+		if (move.GetFrom() != squares.front() || move.GetTo() != squares.back())
+			continue;
+
+		if (squares.size() > 2 && (squares.size() != move.Length || !std::equal(squares.begin(), squares.end(), move.Path)))
+			continue;
+
+		if (found != -1 && moves[found].Position != move.Position)
+			throw std::runtime_error(std::format("Ambiguous move {}, give the full capture path", token));
+
+		if (found == -1)
+			found = i;
+	}
+
+	if (found == -1)
+		throw std::runtime_error(std::format("Illegal move {}", token));
+
+	return found;
+}
+
+std::vector<GameRecord> Pdn::Read(std::string_view text)
+{
+	std::vector<GameRecord> records;
+	std::vector<Move> moves;
+
+	GameRecord record;
+	Position position = record.Start;
+	bool started = false;
+
+	auto finish = [&](GameResult result) {
+		record.Result = result;
+		records.push_back(std::move(record));
+
+		record = GameRecord();
+		position = record.Start;
+		started = false;
+	};
+
+	for (size_t i = 0; i < text.size();)
+	{
+		const char c = text[i];
+
+		if (std::isspace((unsigned char)c))
+		{
+			i++;
+			continue;
+		}
+
+		if (c == '{' || c == '(')
+		{
+			const char close = c == '{' ? '}' : ')';
+			size_t end = text.find(close, i);
+			if (end == std::string_view::npos)
+				throw std::runtime_error("Unterminated comment");
+
+			i = end + 1;
+			continue;
+		}
+
+		if (c == '[')
+		{
+			size_t end = text.find(']', i);
+			size_t open = text.find('"', i), close = open == std::string_view::npos ? open : text.find('"', open + 1);
+			if (end == std::string_view::npos || close == std::string_view::npos || close > end)
+				throw std::runtime_error("Invalid tag");
+
+			std::string name(text.substr(i + 1, open - i - 1));
+			name.erase(name.find_last_not_of(' ') + 1);
+			const std::string value(text.substr(open + 1, close - open - 1));
+
+			if (started)
+				finish(GameResult::Unfinished);
+
+			if (name == "FEN")
+			{
+				const int8_t sinceCapture = record.Start.SinceCapture;
+				record.Start = ParseFen(value);
+				record.Start.SinceCapture = sinceCapture;
+				position = record.Start;
+			}
+			else if (name == "SinceCapture")
+			{
+				record.Start.SinceCapture = std::atoi(value.c_str());
+				position = record.Start;
+			}
+			else if (name == "Termination" && value == "time forfeit")
+				record.Termination = GameTermination::TimeForfeit;
+			else if (name != "Result")
+				record.Tags.emplace_back(name, value);
+
+			i = end + 1;
+			continue;
+		}
+
+		size_t end = i;
+		while (end < text.size() && !std::isspace((unsigned char)text[end]) && text[end] != '{' && text[end] != '[')
+			end++;
+
+		std::string_view token = text.substr(i, end - i);
+		i = end;
+
+		GameResult result;
+		if (ParseResult(token, result))
+		{
+			finish(result);
+			continue;
+		}
+
+		// Move numbers, "1." or "1..." possibly followed by the move without a space
+		const size_t dot = token.find_last_of('.');
+		if (dot != std::string_view::npos)
+			token = token.substr(dot + 1);
+		if (token.empty())
+			continue;
+
+		const uint16_t move = ParseMove(token, position, moves);
+		record.Moves.push_back(move);
+		position = moves[move].Position;
+		started = true;
+	}
+
+	if (started)
+		finish(GameResult::Unfinished);
+
+	return records;
+}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "MoveGenerator.h"
+#include "Position.h"
+
+namespace Checkers
+{
+
+enum class GameResult : uint8_t
+{
+	Unfinished,
+	WhiteWin,
+	BlackWin,
+	Draw
+};
+
+// How a finished game ended, a time forfeit ends it in a position that isn't lost
+enum class GameTermination : uint8_t
+{
+	Normal,
+	TimeForfeit
+};
+
+struct MoveStats
+{
+	uint32_t Simulations;
+	float WinRate;
+	uint32_t TimeMs;
+};
+
+struct GameRecord
+{
+	Position Start = StartingPosition;
+
+	// Indices into the moves of MoveGenerator
+	std::vector<uint16_t> Moves = {};
+	GameResult Result = GameResult::Unfinished;
+	GameTermination Termination = GameTermination::Normal;
+
+	// Empty or one entry per move
+	std::vector<MoveStats> Stats = {};
+
+	// PDN tags other than Result, FEN and a time forfeit Termination
+	std::vector<std::pair<std::string, std::string>> Tags = {};
+
+	// Plays the moves from Start and checks the result against the final position
+	// Throws std::runtime_error on an illegal move or a wrong result, moves is scratch space
+	Position Replay(std::vector<Move> &moves) const;
+};
+
+// Stream of self-contained records, each a fixed header followed by varint move indices and optional stats
+// Header (little endian): magic, version, flags, result, termination, start position, move count, payload size
+class BinaryRecord
+{
+public:
+	static constexpr uint32_t Magic = 0x52474b43u;
+	static constexpr uint8_t Version = 1;
+	static constexpr size_t HeaderSize = 32;
+
+	// Far above the longest game with stats, so that a corrupt header can't request gigabytes
+	static constexpr size_t MaxPayloadSize = 1 << 20;
+
+	static void Write(std::ostream &out, const GameRecord &record);
+
+	// Size of the record at the start of data, throws std::runtime_error on a bad or truncated header
+	static size_t GetSize(std::span<const uint8_t> data);
+
+	// Decodes the record at the start of data, throws std::runtime_error if it's corrupt
+	static GameRecord Read(std::span<const uint8_t> data);
+
+	// Returns false at the end of the stream, throws std::runtime_error on a corrupt record
+	static bool Read(std::istream &in, GameRecord &record);
+
+private:
+	static constexpr uint8_t HasStats = 0x1;
+
+	// Checks the magic, version and payload size of a complete header
+	static size_t GetPayloadSize(std::span<const uint8_t> header);
+};
+
+// Portable Draughts Notation with squares numbered by board index + 1 (square 1 is A1)
+// Captures are written with their full path, on import a capture may also be given by its end squares only
+// A start position with moves since the last capture gets a SinceCapture tag next to FEN
+class Pdn
+{
+public:
+	static std::string Write(const GameRecord &record);
+
+	// All games of the text, throws std::runtime_error on a syntax error or an illegal move
+	static std::vector<GameRecord> Read(std::string_view text);
+};
+
+}
@@ -0,0 +1,292 @@
+#include <format>
+#include <stdexcept>
+
+#include "Core/Core.h"
+
+#include "Controllers/ComputerController.h"
+#include "Controllers/SimulatorPool.h"
+#include "GameSession.h"
+
+namespace Checkers
+{
+
+GameSession::GameSession(ControllerFactory factory, ControllerType black, ControllerType white)
+	: m_Factory(std::move(factory))
+{
+	m_Players[0].Selected = black;
+	m_Players[1].Selected = white;
+}
+
+GameSession::~GameSession()
+{
+	End();
+}
+
+void GameSession::Start(Position position)
+{
+	Reset(position);
+	m_Thread = std::thread(&GameSession::Run, this);
+}
+
+void GameSession::End()
+{
+	m_Finished = true;
+	CancelMoves();
+
+	if (m_Thread.joinable())
+		m_Thread.join();
+	for (std::thread &warmUp : m_WarmUps)
+		warmUp.join();
+	m_WarmUps.clear();
+}
+
+void GameSession::Reset(Position position)
+{
+	std::lock_guard lock(m_Mutex);
+	m_Position = position;
+	m_Finished = false;
+	m_Result = GameResult::Unfinished;
+	m_MoveCount = 0;
+	m_Time[0] = m_Time[1] = std::chrono::nanoseconds(0);
+	m_Started = std::chrono::steady_clock::now();
+	m_FirstMoveTime = m_SetupTime = std::chrono::nanoseconds(0);
+	m_Clock[0] = m_Clock[1] = m_TimeControl.Base;
+}
+
+void GameSession::SetTimeControl(TimeControl timeControl)
+{
+	std::lock_guard lock(m_Mutex);
+	m_TimeControl = timeControl;
+}
+
+bool GameSession::Step()
+{
+	if (m_Finished)
+		return false;
+
+	const Position position = GetState().Position;
+	const bool black = position.BlackTurn;
+	Player &player = GetPlayer(black);
+
+	Position next;
+	Controller *controller;
+	std::chrono::nanoseconds moveTime(0);
+
+	do {
+		const std::chrono::time_point setup(std::chrono::steady_clock::now());
+		controller = GetController(player, black);
+
+		Clock clock;
+		{
+			std::lock_guard lock(m_Mutex);
+			clock.MoveNumber = m_MoveCount / 2;
+			if (m_TimeControl.IsEnabled())
+			{
+				clock.Remaining = m_Clock[black ? 0 : 1] - moveTime - (std::chrono::steady_clock::now() - setup);
+				clock.Increment = m_TimeControl.Increment;
+			}
+		}
+		controller->SetClock(clock);
+
+		const std::chrono::time_point start(std::chrono::steady_clock::now());
+		{
+			Timer<"Controller Move"> timer;
+			next = controller->MakeMove(position);
+		}
+
+		std::lock_guard lock(m_Mutex);
+		moveTime += std::chrono::steady_clock::now() - setup;
+		m_Time[black ? 0 : 1] += std::chrono::steady_clock::now() - setup;
+		m_SetupTime += start - setup;
+
+		if (m_Finished)
+			return false;
+	} while (controller->GetControllerType() != player.Selected);
+
+	{
+		std::lock_guard lock(m_Mutex);
+
+		if (m_TimeControl.IsEnabled())
+		{
+			std::chrono::nanoseconds &clock = m_Clock[black ? 0 : 1];
+			clock -= moveTime;
+
+			// The move made after the flag fell doesn't count
+			if (clock < std::chrono::nanoseconds(0))
+			{
+				m_Result = black ? GameResult::WhiteWin : GameResult::BlackWin;
+				m_Finished = true;
+			}
+			else
+				clock += m_TimeControl.Increment;
+		}
+	}
+
+	if (m_Finished)
+	{
+		if (m_OnMove)
+			m_OnMove(*this);
+
+		return false;
+	}
+
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Position = next;
+		if (m_MoveCount++ == 0)
+			m_FirstMoveTime = std::chrono::steady_clock::now() - m_Started;
+
+		if (next.HasLost())
+			m_Result = next.BlackTurn ? GameResult::WhiteWin : GameResult::BlackWin;
+		else if (next.IsDraw())
+			m_Result = GameResult::Draw;
+
+		if (m_Result != GameResult::Unfinished)
+			m_Finished = true;
+	}
+
+	if (m_OnMove)
+		m_OnMove(*this);
+
+	return !m_Finished;
+}
+
+ControllerType GameSession::GetBlackPlayerType() const
+{
+	return m_Players[0].Selected;
+}
+
+ControllerType GameSession::GetWhitePlayerType() const
+{
+	return m_Players[1].Selected;
+}
+
+void GameSession::SelectBlackPlayer(ControllerType type)
+{
+	m_Players[0].Selected = type;
+	if (Controller *controller = m_Players[0].Current)
+		controller->CancelMove();
+}
+
+void GameSession::SelectWhitePlayer(ControllerType type)
+{
+	m_Players[1].Selected = type;
+	if (Controller *controller = m_Players[1].Current)
+		controller->CancelMove();
+}
+
+SessionState GameSession::GetState() const
+{
+	std::lock_guard lock(m_Mutex);
+	return SessionState{
+		.Position = m_Position,
+		.Finished = m_Finished,
+		.Result = m_Result,
+		.MoveCount = m_MoveCount,
+		.BlackTime = m_Time[0],
+		.WhiteTime = m_Time[1],
+		.FirstMoveTime = m_FirstMoveTime,
+		.SetupTime = m_SetupTime,
+		.TimeControl = m_TimeControl,
+		.BlackClock = m_Clock[0],
+		.WhiteClock = m_Clock[1]
+	};
+}
+
+void GameSession::WarmUp()
+{
+	m_WarmUps.emplace_back([this] {
+		Trace::SetThreadName("Warm-up");
+
+		for (bool black : { true, false })
+		{
+			Player &player = GetPlayer(black);
+			const ControllerType type = player.Selected;
+			if (type == ControllerType::PlayerController)
+				continue;
+
+			std::lock_guard lock(player.Mutex);
+
+			// One that already exists may be searching
+			std::unique_ptr<Controller> &controller = player.Controllers[(size_t)type];
+			if (controller != nullptr)
+				continue;
+
+			try
+			{
+				Timer<"Controller Warm-up"> timer;
+				controller = m_Factory(type, black);
+				if (controller != nullptr)
+					controller->WarmUp();
+			}
+			catch (const std::exception &)
+			{
+				// The move that needs the controller creates it again and reports the error
+				controller = nullptr;
+			}
+		}
+	});
+}
+
+void GameSession::HandleClick(float x, float y)
+{
+	if (m_Finished) return;
+
+	if (Controller *controller = GetPlayer(GetState().Position.BlackTurn).Current)
+		controller->OnClick(x, y);
+}
+
+void GameSession::SetOnMove(std::function<void(const GameSession &)> onMove)
+{
+	m_OnMove = std::move(onMove);
+}
+
+std::unique_ptr<Controller> GameSession::CreateComputerController(ControllerType type, bool black)
+{
+	if (type == ControllerType::ComputerHostController)
+		return std::make_unique<ComputerController>(type, std::unique_ptr<Simulator>(Simulator::CreateHost()), 1e9, std::chrono::seconds(1));
+
+	SimulationBatcher *pool = SimulatorPool::Get(type);
+	if (pool == nullptr)
+		return nullptr;
+
+	std::unique_ptr<Simulator> client(pool->CreateClient(std::format("{} {}", black ? "Black" : "White",
+		type == ControllerType::ComputerDeviceController ? "GPU" : "CPU threaded"
+	)));
+
+	return std::make_unique<ComputerController>(type, std::move(client), 1e9, std::chrono::seconds(1), pool->GetBatchSize());
+}
+
+Controller *GameSession::GetController(Player &player, bool black)
+{
+	std::lock_guard lock(player.Mutex);
+
+	const ControllerType type = player.Selected;
+	std::unique_ptr<Controller> &controller = player.Controllers[(size_t)type];
+
+	if (controller == nullptr)
+		controller = m_Factory(type, black);
+	if (controller == nullptr)
+		throw std::runtime_error(std::format("No controller of type {}", (int)type));
+
+	// Armed before it's published, so that a cancel arriving before MakeMove starts isn't lost
+	controller->PrepareMove();
+	player.Current = controller.get();
+	return controller.get();
+}
+
+void GameSession::CancelMoves()
+{
+	for (Player &player : m_Players)
+		if (Controller *controller = player.Current)
+			controller->CancelMove();
+}
+
+void GameSession::Run()
+{
+	Trace::SetThreadName("Game");
+
+	while (Step());
+}
+
+}
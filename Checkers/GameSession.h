@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Controllers/Controller.h"
+#include "GameRecord.h"
+#include "Position.h"
+
+namespace Checkers
+{
+
+// Creates the controller of one side of a session, which then owns it
+using ControllerFactory = std::function<std::unique_ptr<Controller>(ControllerType type, bool black)>;
+
+struct SessionState
+{
+	Checkers::Position Position;
+
+	bool Finished;
+	GameResult Result;
+	size_t MoveCount;
+
+	// Time each side spent on its moves
+	std::chrono::nanoseconds BlackTime, WhiteTime;
+
+	// From the start of the game to the end of its first move, 0 before that
+	std::chrono::nanoseconds FirstMoveTime;
+
+	// Part of the moves spent creating controllers or waiting for their warm-up
+	std::chrono::nanoseconds SetupTime;
+
+	// Time left on the clocks, the side whose clock runs out loses
+	Checkers::TimeControl TimeControl;
+	std::chrono::nanoseconds BlackClock, WhiteClock;
+};
+
+// One game with its own position, controllers and clock
+// It's either played on its own thread (Start) or one move at a time by a SessionManager worker (Step)
+class GameSession
+{
+public:
+	GameSession(ControllerFactory factory, ControllerType black, ControllerType white);
+	~GameSession();
+
+	// Plays from position on the session thread until the game is finished or ended
+	void Start(Position position = StartingPosition);
+
+	// Finishes the game, cancels the move in progress and joins the session thread
+	void End();
+
+	// Starts a new game from position without a thread of its own
+	void Reset(Position position = StartingPosition);
+
+	// Used by the games started after this, a move's time includes creating its controller
+	void SetTimeControl(TimeControl timeControl);
+
+	// Blocking, plays one move of the side to move, returns false once the game is finished
+	bool Step();
+
+	ControllerType GetBlackPlayerType() const;
+	ControllerType GetWhitePlayerType() const;
+
+	// The controller is created on first use, a move in progress is cancelled and searched again by the new one
+	void SelectBlackPlayer(ControllerType type);
+	void SelectWhitePlayer(ControllerType type);
+
+	// A copy taken under the lock, the thread playing the session updates it after every move
+	SessionState GetState() const;
+
+	// Creates the controllers of the selected computer players on a background thread and warms them up
+	// Returns immediately, a move that needs one of them waits for its warm-up
+	void WarmUp();
+
+	// Forwarded to the controller of the side to move (UI thread)
+	void HandleClick(float x, float y);
+
+	// Called after every move by the thread playing the session
+	void SetOnMove(std::function<void(const GameSession &)> onMove);
+
+	// Computer controllers with the search settings of the window, simulating through the SimulatorPool
+	static std::unique_ptr<Controller> CreateComputerController(ControllerType type, bool black);
+
+private:
+	static constexpr size_t ControllerTypeCount = 4;
+
+	struct Player
+	{
+		std::atomic<ControllerType> Selected;
+		std::atomic<Controller *> Current = nullptr;
+
+		// Guards creation against the warm-up thread
+		std::mutex Mutex;
+		std::array<std::unique_ptr<Controller>, ControllerTypeCount> Controllers = {};
+	};
+
+	ControllerFactory m_Factory;
+	Player m_Players[2];
+
+	mutable std::mutex m_Mutex;
+	Position m_Position = StartingPosition;
+	std::atomic<bool> m_Finished = false;
+	GameResult m_Result = GameResult::Unfinished;
+	size_t m_MoveCount = 0;
+	std::chrono::nanoseconds m_Time[2] = {};
+	std::chrono::steady_clock::time_point m_Started = {};
+	std::chrono::nanoseconds m_FirstMoveTime = {}, m_SetupTime = {};
+	TimeControl m_TimeControl = {};
+	std::chrono::nanoseconds m_Clock[2] = {};
+
+	std::function<void(const GameSession &)> m_OnMove = {};
+	std::thread m_Thread;
+	std::vector<std::thread> m_WarmUps;
+
+	Player &GetPlayer(bool black) { return m_Players[black ? 0 : 1]; }
+	Controller *GetController(Player &player, bool black);
+	void CancelMoves();
+	void Run();
+};
+
+}
@@ -0,0 +1,96 @@
+#include "MoveGenerator.h"
+
+namespace Checkers
+{
+
+void MoveGenerator::Generate(const Position &position, std::vector<Move> &moves)
+{
+	moves.clear();
+
+	Bitboard capturing = position.GetAllCapturing();
+
+	if (capturing)
+	{
+		int choices[32];
+		int choiceCnt = Board::GetBits(capturing, choices);
+
+		for (int choiceIdx = 0; choiceIdx < choiceCnt; choiceIdx++)
+		{
+			Move move = {
+				.Path = { (uint8_t)choices[choiceIdx] },
+				.Length = 1,
+				.IsCapture = true,
+				.Position = position
+			};
+			AddCaptures(move, moves);
+		}
+
+		return;
+	}
+
+	int fromChoices[32];
+	int fromChoiceCount = Board::GetBits(position.GetAllMoving(), fromChoices);
+	for (int i = 0; i < fromChoiceCount; i++)
+	{
+		const int fromIndex = fromChoices[i];
+
+		int toChoices[32];
+		int toChoiceCount = Board::GetBits(position.GetMoves(Board::FromIndex(fromIndex)), toChoices);
+		for (int j = 0; j < toChoiceCount; j++)
+		{
+			Move move = {
+				.Path = { (uint8_t)fromIndex, (uint8_t)toChoices[j] },
+				.Length = 2,
+				.IsCapture = false,
+				.Position = position
+			};
+
+			move.Position.Move(fromIndex, toChoices[j]);
+			move.Position.EndTurn();
+
+			moves.push_back(move);
+		}
+	}
+}
+
+void MoveGenerator::AddCaptures(Move &move, std::vector<Move> &moves)
+{
+	const int fromIndex = move.GetTo();
+	Bitboard captures = move.Position.GetCaptures(Board::FromIndex(fromIndex));
+
+	if (Board::IsEmpty(captures))
+	{
+		Move complete = move;
+		complete.Position.EndTurn();
+		moves.push_back(complete);
+
+		return;
+	}
+
+	int choices[32];
+	int choiceCnt = Board::GetBits(captures, choices);
+
+	for (int choiceIdx = 0; choiceIdx < choiceCnt; choiceIdx++)
+	{
+		const int toIndex = choices[choiceIdx];
+
+		Move next = move;
+		next.Position.Capture(fromIndex, toIndex);
+		next.Path[next.Length++] = toIndex;
+
+		AddCaptures(next, moves);
+	}
+}
+
+int MoveGenerator::Find(const Position &position, const Position &next, std::vector<Move> &moves)
+{
+	Generate(position, moves);
+
+	for (size_t i = 0; i < moves.size(); i++)
+		if (moves[i].Position == next)
+			return i;
+
+	return -1;
+}
+
+}
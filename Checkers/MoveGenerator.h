@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Position.h"
+
+namespace Checkers
+{
+
+struct Move
+{
+	// At most one capture per opponent piece
+	static constexpr int MaxPathLength = 13;
+
+	// Squares visited by the moving piece, the first one is where it starts
+	uint8_t Path[MaxPathLength];
+	uint8_t Length;
+	bool IsCapture;
+
+	// Position after the move, with the turn already passed to the opponent
+	Checkers::Position Position;
+
+	int GetFrom() const { return Path[0]; }
+	int GetTo() const { return Path[Length - 1]; }
+};
+
+// Legal moves in a fixed order, so that a move index means the same in records and training data
+// Different capture sequences with the same result are separate moves, the tree keeps only the first of them
+// (its children follow the first moves leading to each distinct position, see the mapping in Tools/SelfPlay.cpp)
+class MoveGenerator
+{
+public:
+	// Replaces the contents of moves, which keeps its capacity between calls
+	static void Generate(const Position &position, std::vector<Move> &moves);
+
+	// Index of the move that turns position into next, -1 if there is no such move
+	static int Find(const Position &position, const Position &next, std::vector<Move> &moves);
+
+private:
+	static void AddCaptures(Move &move, std::vector<Move> &moves);
+};
+
+}
@@ -1,31 +1,6 @@
 #pragma once
 
-#include <cuda.h>
-#include <cuda_runtime.h>
-
-#ifdef __CUDA_ARCH__
-
-#include <cuda/std/bit>
-#include <cuda/std/cassert>
-#include <cuda/std/type_traits>
-
-namespace stl = cuda::std;
-
-#define CONSTANT __constant__
-
-#else
-
-#include <bit>
-#include <cassert>
-#include <cstdint>
-#include <random>
-#include <type_traits>
-#include <utility>
-
-namespace stl = std;
-#define CONSTANT
-
-#endif
+#include "Core/Platform.h"
 
 namespace Checkers
 {
@@ -181,6 +156,8 @@ struct Position
 	int8_t SinceCapture;
 	bool BlackTurn;
 
+	constexpr bool operator==(const Position &other) const = default;
+
 private:
 	static inline constexpr uint8_t MovesTillDraw = 30;
 
@@ -551,27 +528,29 @@ public:
 		Move(fromIndex, toIndex);
 	}
 
+	// Returns the number of plies played
 	template<typename G>
-	__host__ __device__ __inline__ void SimulateOne(G &generator, int &blackInc, int &whiteInc)
+	__host__ __device__ __inline__ int SimulateOne(G &generator, int &blackInc, int &whiteInc)
 	{
-		static constexpr int MaxMoves = 40;
-
-		int i = 0;
-		while (!HasLost() && !IsDraw() && i < MaxMoves)
+		// Playouts run until the game ends, the draw rule bounds their length
+		int plies = 0;
+		while (!HasLost() && !IsDraw())
 		{
 			RandomMove(generator);
 			EndTurn();
+			plies++;
 		}
 
-		if (IsDraw() || i == MaxMoves)
+		if (IsDraw())
 		{
 			blackInc = 1;
 			whiteInc = 1;
-			return;
+			return plies;
 		}
 
 		blackInc = (!BlackTurn) * 2;
 		whiteInc = BlackTurn * 2;
+		return plies;
 	}
 };
 
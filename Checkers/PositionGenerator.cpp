@@ -0,0 +1,79 @@
+#include <bit>
+#include <format>
+#include <stdexcept>
+
+#include "PositionGenerator.h"
+
+namespace Checkers
+{
+
+PositionGenerator::PositionGenerator(unsigned int seed) : m_Generator(seed)
+{
+}
+
+Position PositionGenerator::Generate(int pieceCount, int queenCount)
+{
+	return Generate(1, pieceCount, queenCount).front();
+}
+
+std::vector<Position> PositionGenerator::Generate(size_t count, int pieceCount, int queenCount)
+{
+	if (pieceCount < 2 || pieceCount > 24 || queenCount < 0 || queenCount > pieceCount)
+		throw std::invalid_argument(std::format("Can't generate a position with {} pieces and {} queens", pieceCount, queenCount));
+
+	std::vector<Position> positions;
+	positions.reserve(count);
+
+	int attempts = 0;
+	while (positions.size() < count)
+	{
+		// Attempts without a single match, games that produce positions don't count
+		if (attempts++ == MaxAttempts)
+			throw std::runtime_error(std::format("No position with {} pieces and {} queens reached in {} games", pieceCount, queenCount, MaxAttempts));
+
+		Position position = StartingPosition;
+
+		while (!position.HasLost() && !position.IsDraw() && positions.size() < count)
+		{
+			const int pieces = std::popcount(position.Black | position.White);
+			const int queens = std::popcount(position.Queens);
+
+			// Pieces are never added back, so this game can't reach the target anymore
+			if (pieces < pieceCount)
+				break;
+
+			if (pieces == pieceCount && queens == queenCount)
+			{
+				positions.push_back(position);
+				attempts = 0;
+			}
+
+			position.RandomMove(m_Generator);
+			position.EndTurn();
+		}
+	}
+
+	return positions;
+}
+
+Position PositionGenerator::GenerateOpening(int plies)
+{
+	for (int attempt = 0; attempt < MaxAttempts; attempt++)
+	{
+		Position position = StartingPosition;
+
+		int ply = 0;
+		for (; ply < plies && !position.HasLost() && !position.IsDraw(); ply++)
+		{
+			position.RandomMove(m_Generator);
+			position.EndTurn();
+		}
+
+		if (ply == plies && !position.HasLost() && !position.IsDraw())
+			return position;
+	}
+
+	throw std::runtime_error(std::format("No position reached after {} plies in {} games", plies, MaxAttempts));
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include "Controllers/HostSimulator.h"
+#include "Position.h"
+
+namespace Checkers
+{
+
+// Generates legal positions by random play from the starting position
+class PositionGenerator
+{
+public:
+	PositionGenerator(unsigned int seed);
+
+	// Non-terminal position with exactly pieceCount pieces on the board, queenCount of them queens
+	// Throws if no such position was reached within a bounded number of random games
+	Position Generate(int pieceCount, int queenCount);
+
+	// Like Generate, but every matching position along a random game is used, which is much faster
+	// when many positions are needed (consecutive positions of one game are correlated)
+	std::vector<Position> Generate(size_t count, int pieceCount, int queenCount);
+
+	// Non-terminal position reached after the given number of random plies
+	Position GenerateOpening(int plies);
+
+private:
+	static constexpr int MaxAttempts = 100000;
+
+	HostGenerator m_Generator;
+};
+
+}
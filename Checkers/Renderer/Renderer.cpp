@@ -12,9 +12,9 @@ namespace Checkers
 
 static RendererImpl *s_Renderer;
 
-void Renderer::Init(const Position &position)
+void Renderer::Init()
 {
-	static RendererImpl renderer(position);
+	static RendererImpl renderer;
 	s_Renderer = &renderer;
 }
 
@@ -52,9 +52,9 @@ void Renderer::Resize(uint32_t width, uint32_t height)
 	s_Renderer->Resize(width, height);
 }
 
-void Renderer::Render()
+void Renderer::Render(const Position &position)
 {
-	s_Renderer->Render();
+	s_Renderer->Render(position);
 }
 
 }
@@ -10,7 +10,7 @@ namespace Checkers
 class Renderer
 {
 public:
-	static void Init(const Position &position);
+	static void Init();
 	static void Shutdown();
 
 	static uint32_t GetTextureId();
@@ -22,7 +22,7 @@ public:
 	static void Flip();
 
 	static void Resize(uint32_t width, uint32_t height);
-	static void Render();
+	static void Render(const Position &position);
 };
 
 }
@@ -20,13 +20,12 @@ static constexpr glm::vec3 Highlighted = glm::vec3(235.0f, 97.0f, 80.0f) / 255.0
 
 }
 
-RendererImpl::RendererImpl(const Position &m_Position)
+RendererImpl::RendererImpl()
 	: m_Shader(Resources::VertexShaderSource, Resources::FragmentShaderSource), m_Textures{ Texture(0xffffffff),
 	Texture(Resources::BlackPawnImage), Texture(Resources::WhitePawnImage),
 	Texture(Resources::BlackQueenImage), Texture(Resources::WhiteQueenImage),
 	Texture(Resources::BlackPawnImage, true), Texture(Resources::WhitePawnImage, true),
-	Texture(Resources::BlackQueenImage, true), Texture(Resources::WhiteQueenImage, true)},
-	m_Position(m_Position), m_Flipped(false)
+	Texture(Resources::BlackQueenImage, true), Texture(Resources::WhiteQueenImage, true)}
 {
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -119,7 +118,7 @@ void RendererImpl::Resize(uint32_t width, uint32_t height)
 	m_Framebuffer.Resize(m_ViewportWidth, m_ViewportHeight);
 }
 
-void RendererImpl::Render()
+void RendererImpl::Render(const Position &position)
 {
 	m_QuadCount = 0;
 	for (int j = 0; j < 8; j++)
@@ -131,14 +130,14 @@ void RendererImpl::Render()
 
 			const Bitboard board = Board::FromCoords(i, j);
 
-			if (m_Position.Black & m_Position.Queens & board)
+			if (position.Black & position.Queens & board)
 				AddQuad(i, j, 3);
-			else if (m_Position.Black & board)
+			else if (position.Black & board)
 				AddQuad(i, j, 1);
 
-			if (m_Position.White & m_Position.Queens & board)
+			if (position.White & position.Queens & board)
 				AddQuad(i, j, 4);
-			else if (m_Position.White & board)
+			else if (position.White & board)
 				AddQuad(i, j, 2);
 		}
 
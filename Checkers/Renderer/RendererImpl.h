@@ -13,7 +13,7 @@ namespace Checkers
 class RendererImpl
 {
 public:
-	RendererImpl(const Position &position);
+	RendererImpl();
 	~RendererImpl();
 
 	uint32_t GetTextureId() const;
@@ -25,7 +25,7 @@ public:
 	void Flip();
 
 	void Resize(uint32_t width, uint32_t height);
-	void Render();
+	void Render(const Position &position);
 
 private:
 	static constexpr size_t MaxQuads = 100;
@@ -49,13 +49,11 @@ private:
 
 	Shader m_Shader;
 
-	bool m_Flipped;
+	bool m_Flipped = false;
 	std::array<Texture, 9> m_Textures;
 
 	std::array<std::array<glm::vec3, 8>, 8> m_Colors = {};
 
-	const Position &m_Position;
-
 	void AddQuad(int i, int j, uint8_t texture, glm::vec3 color = glm::vec3(1));
 };
 
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <iostream>
+
+#include "Core/Core.h"
+
+#include "SessionManager.h"
+
+namespace Checkers
+{
+
+SessionManager::SessionManager(unsigned int workerCount, ControllerFactory factory)
+	: m_Factory(std::move(factory))
+{
+	for (unsigned int i = 0; i < std::max(workerCount, 1u); i++)
+		m_Workers.emplace_back(&SessionManager::WorkerLoop, this);
+}
+
+SessionManager::~SessionManager()
+{
+	std::vector<std::shared_ptr<GameSession>> sessions;
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Stopping = true;
+
+		for (const auto &[id, session] : m_Sessions)
+			sessions.push_back(session);
+	}
+	m_SessionReady.notify_all();
+
+	for (const std::shared_ptr<GameSession> &session : sessions)
+		session->End();
+
+	for (std::thread &worker : m_Workers)
+		worker.join();
+}
+
+SessionId SessionManager::Create(ControllerType black, ControllerType white, Position position, SessionMoveHandler onMove)
+{
+	std::shared_ptr<GameSession> session = std::make_shared<GameSession>(m_Factory, black, white);
+	session->Reset(position);
+
+	SessionId id;
+	{
+		std::lock_guard lock(m_Mutex);
+		id = m_NextId++;
+
+		// Set before the session is queued, so that no worker plays a move without it
+		if (onMove)
+			session->SetOnMove([onMove = std::move(onMove), id](const GameSession &game) { onMove(id, game); });
+
+		m_Sessions.emplace(id, session);
+		m_Ready.push_back(std::move(session));
+	}
+	m_SessionReady.notify_one();
+
+	return id;
+}
+
+std::shared_ptr<GameSession> SessionManager::Get(SessionId id) const
+{
+	std::lock_guard lock(m_Mutex);
+
+	auto it = m_Sessions.find(id);
+	return it == m_Sessions.end() ? nullptr : it->second;
+}
+
+void SessionManager::Remove(SessionId id)
+{
+	std::shared_ptr<GameSession> session;
+	{
+		std::lock_guard lock(m_Mutex);
+
+		auto it = m_Sessions.find(id);
+		if (it == m_Sessions.end())
+			return;
+
+		session = std::move(it->second);
+		m_Sessions.erase(it);
+	}
+
+	// A worker playing a move of it drops it once the move is cancelled
+	session->End();
+}
+
+void SessionManager::WaitAll()
+{
+	std::unique_lock lock(m_Mutex);
+	m_SessionDone.wait(lock, [&] {
+		for (const auto &[id, session] : m_Sessions)
+			if (!session->GetState().Finished)
+				return false;
+		return true;
+	});
+}
+
+size_t SessionManager::GetSessionCount() const
+{
+	std::lock_guard lock(m_Mutex);
+	return m_Sessions.size();
+}
+
+void SessionManager::WorkerLoop()
+{
+	Trace::SetThreadName("Session Worker");
+
+	std::unique_lock lock(m_Mutex);
+	while (true)
+	{
+		m_SessionReady.wait(lock, [&] { return m_Stopping || !m_Ready.empty(); });
+		if (m_Stopping)
+			return;
+
+		std::shared_ptr<GameSession> session = std::move(m_Ready.front());
+		m_Ready.pop_front();
+		lock.unlock();
+
+		bool playing = false;
+		try
+		{
+			playing = session->Step();
+		}
+		catch (const std::exception &exception)
+		{
+			std::cerr << "Session ended: " << exception.what() << std::endl;
+			session->End();
+		}
+
+		lock.lock();
+		if (playing && !m_Stopping)
+		{
+			m_Ready.push_back(std::move(session));
+			m_SessionReady.notify_one();
+		}
+		else
+			m_SessionDone.notify_all();
+	}
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "GameSession.h"
+
+namespace Checkers
+{
+
+using SessionId = uint64_t;
+
+// Called after every move of a session by the worker that played it
+using SessionMoveHandler = std::function<void(SessionId id, const GameSession &session)>;
+
+// Runs many sessions on a shared pool of workers, each worker plays one move of a session at a time
+// Sessions take turns in the order their previous move finished, so a long game doesn't hold a worker
+// A worker waits for a human player, so sessions with one should run on their own thread instead
+class SessionManager
+{
+public:
+	SessionManager(unsigned int workerCount, ControllerFactory factory = GameSession::CreateComputerController);
+	~SessionManager();
+
+	SessionId Create(ControllerType black, ControllerType white, Position position = StartingPosition, SessionMoveHandler onMove = {});
+
+	// nullptr if there is no such session
+	std::shared_ptr<GameSession> Get(SessionId id) const;
+
+	// Ends the session and cancels its move in progress
+	void Remove(SessionId id);
+
+	// Blocks until every session is finished or removed
+	void WaitAll();
+
+	size_t GetSessionCount() const;
+	unsigned int GetWorkerCount() const { return (unsigned int)m_Workers.size(); }
+
+private:
+	ControllerFactory m_Factory;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_SessionReady, m_SessionDone;
+
+	std::unordered_map<SessionId, std::shared_ptr<GameSession>> m_Sessions;
+	std::deque<std::shared_ptr<GameSession>> m_Ready;
+	SessionId m_NextId = 1;
+	bool m_Stopping = false;
+
+	std::vector<std::thread> m_Workers;
+
+	void WorkerLoop();
+};
+
+}
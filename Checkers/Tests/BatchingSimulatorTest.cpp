@@ -0,0 +1,98 @@
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Controllers/BatchingSimulator.h"
+#include "PositionGenerator.h"
+
+using namespace Checkers;
+
+// Results identify the position they belong to, simulation blocks until released
+class GateSimulator : public Simulator
+{
+public:
+	static int GetResult(const Position &position)
+	{
+		return (int)((position.Black ^ position.White * 31) & 0x7fffffff);
+	}
+
+	void Simulate(const std::vector<Position> &positions, std::vector<int> &blackInc, std::vector<int> &whiteInc, std::vector<int> &visitsInc) override
+	{
+		std::unique_lock lock(m_Mutex);
+		m_Started = true;
+		m_Changed.notify_all();
+		m_Changed.wait(lock, [&] { return m_Released; });
+
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			blackInc[i] = GetResult(positions[i]);
+			whiteInc[i] = 0;
+			visitsInc[i] = 2;
+		}
+	}
+
+	void WaitStarted()
+	{
+		std::unique_lock lock(m_Mutex);
+		m_Changed.wait(lock, [&] { return m_Started; });
+	}
+
+	void Release()
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Released = true;
+		m_Changed.notify_all();
+	}
+
+private:
+	std::mutex m_Mutex;
+	std::condition_variable m_Changed;
+	bool m_Started = false, m_Released = false;
+};
+
+// A client removed while its request is being simulated must not shift the results of the requests after it
+static bool RemoveClientDuringBatch()
+{
+	GateSimulator *simulator = new GateSimulator();
+	SimulationBatcher batcher(simulator, 3, std::chrono::seconds(10));
+
+	// The higher priority puts the removed client first in the batch
+	std::unique_ptr<Simulator> removed(batcher.CreateClient("removed", 1, 1));
+	std::unique_ptr<Simulator> kept(batcher.CreateClient("kept", 1, 0));
+
+	PositionGenerator generator(7);
+	const std::vector<Position> removedPositions = { generator.GenerateOpening(3) };
+	const std::vector<Position> keptPositions = { generator.GenerateOpening(5), generator.GenerateOpening(9) };
+
+	removed->Submit(removedPositions);
+	const SimulationTicket ticket = kept->Submit(keptPositions);
+
+	simulator->WaitStarted();
+	removed.reset();
+	simulator->Release();
+
+	std::vector<int> blackInc(2), whiteInc(2), visitsInc(2);
+	kept->Wait(ticket, blackInc, whiteInc, visitsInc);
+
+	bool passed = true;
+	for (size_t i = 0; i < keptPositions.size(); i++)
+		if (blackInc[i] != GateSimulator::GetResult(keptPositions[i]) || visitsInc[i] != 2)
+		{
+			std::cerr << "Position " << i << " of the kept client got the result of another position\n";
+			passed = false;
+		}
+
+	return passed;
+}
+
+int main()
+{
+	if (!RemoveClientDuringBatch())
+		return EXIT_FAILURE;
+
+	std::cout << "All tests passed\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "MoveGenerator.h"
+#include "SessionManager.h"
+
+using namespace Checkers;
+
+// Always plays the first legal move, so that every game is short and the same
+class FirstMoveController : public Controller
+{
+public:
+	FirstMoveController(ControllerType type) : Controller(type) {}
+
+	void OnClick(float x, float y) override {}
+	void CancelMove() override {}
+
+	Position MakeMove(Position position) override
+	{
+		MoveGenerator::Generate(position, m_Moves);
+		return m_Moves.front().Position;
+	}
+
+private:
+	std::vector<Move> m_Moves;
+};
+
+// Doesn't return from its move until it's cancelled
+class BlockingController : public Controller
+{
+public:
+	BlockingController(ControllerType type) : Controller(type) {}
+
+	void OnClick(float x, float y) override {}
+
+	Position MakeMove(Position position) override
+	{
+		std::unique_lock lock(s_Mutex);
+		s_Started = true;
+		s_Changed.notify_all();
+		s_Changed.wait(lock, [&] { return m_Cancelled; });
+
+		return position;
+	}
+
+	void CancelMove() override
+	{
+		std::lock_guard lock(s_Mutex);
+		m_Cancelled = true;
+		s_Changed.notify_all();
+	}
+
+	static void WaitStarted()
+	{
+		std::unique_lock lock(s_Mutex);
+		s_Changed.wait(lock, [&] { return s_Started; });
+	}
+
+private:
+	static inline std::mutex s_Mutex;
+	static inline std::condition_variable s_Changed;
+	static inline bool s_Started = false;
+
+	bool m_Cancelled = false;
+};
+
+// More games than workers, every one is played to the end and reports each of its moves
+static bool PlayEveryGame()
+{
+	std::mutex mutex;
+	std::map<SessionId, size_t> moves;
+
+	std::vector<SessionId> ids;
+	{
+		SessionManager manager(2, [](ControllerType type, bool black) { return std::make_unique<FirstMoveController>(type); });
+
+		for (int i = 0; i < 8; i++)
+			ids.push_back(manager.Create(ControllerType::ComputerHostController, ControllerType::ComputerHostController, StartingPosition,
+				[&](SessionId id, const GameSession &session) {
+					std::lock_guard lock(mutex);
+					moves[id]++;
+				}
+			));
+
+		manager.WaitAll();
+
+		for (SessionId id : ids)
+		{
+			const SessionState state = manager.Get(id)->GetState();
+			if (!state.Finished || state.Result == GameResult::Unfinished || moves[id] != state.MoveCount)
+			{
+				std::cerr << "Game " << id << " wasn't played to the end or missed the report of a move\n";
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+// A removed session gives its worker back without waiting for the move in progress
+static bool RemoveDuringMove()
+{
+	SessionManager manager(1, [](ControllerType type, bool black) { return std::make_unique<BlockingController>(type); });
+
+	const SessionId id = manager.Create(ControllerType::ComputerHostController, ControllerType::ComputerHostController);
+	BlockingController::WaitStarted();
+
+	manager.Remove(id);
+	manager.WaitAll();
+
+	if (manager.Get(id) != nullptr || manager.GetSessionCount() != 0)
+	{
+		std::cerr << "Removed game " << id << " is still managed\n";
+		return false;
+	}
+
+	return true;
+}
+
+int main()
+{
+	if (!PlayEveryGame() || !RemoveDuringMove())
+		return EXIT_FAILURE;
+
+	std::cout << "All tests passed\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,360 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Controllers/ComputerController.h"
+#include "Core/Arena.h"
+#include "Core/Telemetry.h"
+
+using namespace Checkers;
+
+struct EngineOptions
+{
+	std::string Backend = "threaded";
+	unsigned int BatchSize = 64;
+	unsigned int ThreadCount = 0;
+	std::chrono::milliseconds Time = std::chrono::milliseconds(1000);
+	size_t MaxNodes = 20000000;
+	float ExplorationConstant = Tree::DefaultExplorationConstant;
+	bool CompactNodes = false;
+	size_t ReorderThreshold = 0;
+	PageMode Pages = PageMode::Default;
+
+	// "-" sends the lines as telemetry <json> with the protocol output
+	std::string TelemetryPath = {};
+};
+
+static std::mutex s_OutputMutex;
+
+// Lines are written from the command loop and the search thread
+static void WriteLine(const std::string &line)
+{
+	std::lock_guard lock(s_OutputMutex);
+	std::cout << line << '\n' << std::flush;
+}
+
+static std::string FormatPosition(const Position &position)
+{
+	return std::format("{:x} {:x} {:x} {} {}", position.Black, position.White, position.Queens,
+		position.BlackTurn ? 'b' : 'w', position.SinceCapture
+	);
+}
+
+static std::string FormatMove(const SearchMove &move)
+{
+	return std::format("{}-{}", move.From, move.To);
+}
+
+static std::string FormatInfo(const SearchReport &report)
+{
+	std::string info = std::format("info time {} simulations {} reused {} nodes {} sps {:.0f} depth {} avgdepth {:.2f}",
+		report.Time.count() / 1000, report.Simulations, report.ReusedSimulations, report.NodeCount,
+		report.GetSimulationsPerSecond(), report.MaxDepth, report.AverageDepth
+	);
+
+	if (!report.PrincipalVariation.empty())
+	{
+		const SearchMove &best = report.PrincipalVariation.front();
+		info += std::format(" winrate {:.4f} pv", best.Visits == 0 ? 0.0 : best.Wins / (double)best.Visits);
+
+		for (const SearchMove &move : report.PrincipalVariation)
+			info += " " + FormatMove(move);
+	}
+
+	return info;
+}
+
+// One engine with a warm tree, searches run on a separate thread so that stop can be handled
+class EngineSession
+{
+public:
+	EngineSession(const EngineOptions &options, const SimulatorBackend &backend)
+		: m_Options(options), m_Simulator(backend.Create(options.BatchSize, options.ThreadCount)),
+		m_Controller(GetControllerType(options.Backend), m_Simulator.get(), 1e9, options.Time, options.BatchSize, options.ExplorationConstant)
+	{
+		m_Controller.SetSubtreeReuse(true);
+		m_Controller.SetCompactNodes(options.CompactNodes);
+		m_Controller.SetReordering(options.ReorderThreshold);
+
+		m_ReportJson = m_Controller.GetReport().ToJson();
+	}
+
+	~EngineSession()
+	{
+		Stop();
+	}
+
+	void SetPosition(const Position &position)
+	{
+		Stop();
+		m_Position = position;
+	}
+
+	// A pondering search runs until stop and doesn't report a best move, it only warms the tree up
+	void Go(SearchLimits limits, bool ponder)
+	{
+		Stop();
+
+		if (m_Position.HasLost() || m_Position.IsDraw())
+		{
+			if (!ponder)
+				WriteLine("bestmove none");
+			return;
+		}
+
+		limits.MaxNodes = m_Options.MaxNodes;
+
+		m_Stop = false;
+		limits.Stop = &m_Stop;
+		limits.OnInfo = [this](const SearchReport &report) {
+			SetReport(report);
+			WriteLine(FormatInfo(report));
+		};
+
+		m_Search = std::thread([this, limits, ponder]() {
+			Trace::SetThreadName("Engine Search");
+
+			const Position best = m_Controller.MakeMove(m_Position, limits);
+			const SearchReport &report = m_Controller.GetReport();
+
+			SetReport(report);
+			WriteLine(FormatInfo(report));
+
+			if (ponder)
+				return;
+
+			if (report.PrincipalVariation.empty())
+				WriteLine("bestmove none");
+			else
+				WriteLine(std::format("bestmove {} position {}", FormatMove(report.PrincipalVariation.front()), FormatPosition(best)));
+		});
+	}
+
+	void Stop()
+	{
+		m_Stop = true;
+		if (m_Search.joinable())
+			m_Search.join();
+	}
+
+	// Report of the last finished search, or the latest one of the search in progress, which keeps running
+	std::string GetReportJson() const
+	{
+		std::lock_guard lock(m_ReportMutex);
+		return m_ReportJson;
+	}
+
+	SearchLimits GetDefaultLimits() const
+	{
+		return m_Controller.GetDefaultLimits();
+	}
+
+private:
+	const EngineOptions m_Options;
+
+	std::unique_ptr<Simulator> m_Simulator;
+	ComputerController m_Controller;
+
+	Position m_Position = StartingPosition;
+
+	std::thread m_Search;
+	std::atomic<bool> m_Stop = false;
+
+	// Written by the search thread, so that info doesn't read the report of a running search
+	mutable std::mutex m_ReportMutex;
+	std::string m_ReportJson;
+
+	void SetReport(const SearchReport &report)
+	{
+		std::string json = report.ToJson();
+
+		std::lock_guard lock(m_ReportMutex);
+		m_ReportJson = std::move(json);
+	}
+
+	static ControllerType GetControllerType(const std::string &backend)
+	{
+		if (backend == "threaded")
+			return ControllerType::ComputerThreadedHostController;
+		if (backend == "device")
+			return ControllerType::ComputerDeviceController;
+		return ControllerType::ComputerHostController;
+	}
+};
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: checkers_engine [--backend name] [--batch n] [--threads n] [--time ms] [--max-nodes n] [--c x] [--compact-nodes] [--reorder nodes] [--pages default|transparent|explicit]\n"
+		<< "                       [--telemetry file|-]\n";
+}
+
+static const SimulatorBackend *FindBackend(const std::string &name)
+{
+	for (const SimulatorBackend &backend : Simulator::GetBackends())
+		if (name == backend.Name)
+			return &backend;
+
+	return nullptr;
+}
+
+// position startpos | position <black> <white> <queens> <b|w> [sinceCapture], bitboards in hex
+static bool ParsePosition(std::istringstream &stream, Position &position)
+{
+	std::string first;
+	if (!(stream >> first))
+		return false;
+
+	if (first == "startpos")
+	{
+		position = StartingPosition;
+		return true;
+	}
+
+	std::string white, queens, turn;
+	int sinceCapture = 0;
+	if (!(stream >> white >> queens >> turn) || (turn != "b" && turn != "w"))
+		return false;
+	stream >> sinceCapture;
+
+	try
+	{
+		position = Position{
+			(Bitboard)std::stoul(first, nullptr, 16), (Bitboard)std::stoul(white, nullptr, 16),
+			(Bitboard)std::stoul(queens, nullptr, 16), (int8_t)sinceCapture, turn == "b"
+		};
+	}
+	catch (const std::exception &)
+	{
+		return false;
+	}
+
+	return (position.Black & position.White) == 0 && (position.Queens & ~(position.Black | position.White)) == 0;
+}
+
+// go [movetime ms] [simulations n] [nodes n] [infinite]
+static bool ParseLimits(std::istringstream &stream, SearchLimits &limits)
+{
+	for (std::string key; stream >> key;)
+	{
+		uint64_t value = 0;
+		if (key == "infinite")
+			limits.Time = std::chrono::nanoseconds::max();
+		else if (key == "movetime" && stream >> value)
+			limits.Time = std::chrono::milliseconds(value);
+		else if (key == "simulations" && stream >> value)
+			limits.Simulations = value;
+		else if (key == "nodes" && stream >> value)
+			limits.Nodes = value;
+		else
+			return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	EngineOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(argv[i], "--backend") == 0 && hasValue)
+			options.Backend = argv[++i];
+		else if (std::strcmp(argv[i], "--batch") == 0 && hasValue)
+			options.BatchSize = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+			options.ThreadCount = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--time") == 0 && hasValue)
+			options.Time = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--max-nodes") == 0 && hasValue)
+			options.MaxNodes = std::strtoull(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--c") == 0 && hasValue)
+			options.ExplorationConstant = std::strtof(argv[++i], nullptr);
+		else if (std::strcmp(argv[i], "--compact-nodes") == 0)
+			options.CompactNodes = true;
+		else if (std::strcmp(argv[i], "--reorder") == 0 && hasValue)
+			options.ReorderThreshold = std::strtoull(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--pages") == 0 && hasValue && Arena::ParsePageMode(argv[i + 1], options.Pages))
+			i++;
+		else if (std::strcmp(argv[i], "--telemetry") == 0 && hasValue)
+			options.TelemetryPath = argv[++i];
+		else
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	const SimulatorBackend *backend = FindBackend(options.Backend);
+	if (backend == nullptr)
+	{
+		std::cerr << "Unknown backend " << options.Backend << "\n";
+		return EXIT_FAILURE;
+	}
+
+	// Through WriteLine, so that a telemetry line never lands inside a protocol line
+	if (options.TelemetryPath == "-")
+		Telemetry::Open([](std::string_view line) { WriteLine(std::format("telemetry {}", line)); });
+	else if (!options.TelemetryPath.empty() && !Telemetry::Open(options.TelemetryPath))
+	{
+		std::cerr << "Can't open telemetry file " << options.TelemetryPath << "\n";
+		return EXIT_FAILURE;
+	}
+
+	Arena::SetPageMode(options.Pages);
+	EngineSession session(options, *backend);
+
+	for (std::string line; std::getline(std::cin, line);)
+	{
+		std::istringstream stream(line);
+
+		std::string command;
+		if (!(stream >> command))
+			continue;
+
+		if (command == "quit")
+			break;
+		else if (command == "isready")
+			WriteLine("readyok");
+		else if (command == "stop")
+			session.Stop();
+		else if (command == "info")
+			WriteLine("info json " + session.GetReportJson());
+		else if (command == "position")
+		{
+			Position position;
+			if (ParsePosition(stream, position))
+				session.SetPosition(position);
+			else
+				WriteLine("error invalid position");
+		}
+		else if (command == "go" || command == "ponder")
+		{
+			SearchLimits limits = session.GetDefaultLimits();
+			if (command == "ponder")
+				limits.Time = std::chrono::nanoseconds::max();
+
+			if (ParseLimits(stream, limits))
+				session.Go(limits, command == "ponder");
+			else
+				WriteLine("error invalid limits");
+		}
+		else
+			WriteLine("error unknown command " + command);
+	}
+
+	session.Stop();
+	Telemetry::Close();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,495 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Controllers/ComputerController.h"
+#include "Core/Telemetry.h"
+#include "GameRecord.h"
+#include "PositionGenerator.h"
+
+using namespace Checkers;
+
+// backend,time=ms,tc=base+increment,batch=n,threads=n,c=x,expand=n,widen=x
+struct EngineOptions
+{
+	std::string Spec;
+	std::string Backend = "host";
+	std::chrono::milliseconds Time = std::chrono::milliseconds(100);
+	Checkers::TimeControl TimeControl = {};
+	unsigned int BatchSize = 1;
+	unsigned int ThreadCount = 1;
+	float ExplorationConstant = Tree::DefaultExplorationConstant;
+	ExpansionSettings Expansion = {};
+};
+
+struct MatchOptions
+{
+	std::vector<EngineOptions> Engines = {};
+	unsigned int Games = 100;
+	unsigned int Concurrency = std::max(std::thread::hardware_concurrency(), 1u);
+	int OpeningPlies = 4;
+	unsigned int Seed = 1;
+	int MaxPlies = 400;
+
+	// Games are appended as PDN when the path ends in .pdn, as binary records otherwise
+	std::string RecordPath = {};
+
+	// One JSON line per move of either engine, "-" for stdout
+	std::string TelemetryPath = {};
+
+	// SPRT hypotheses in Elo of the first engine over the second
+	double Elo0 = 0.0, Elo1 = 10.0;
+	double Alpha = 0.05, Beta = 0.05;
+};
+
+// Results from the point of view of the first engine
+struct MatchResult
+{
+	uint64_t Wins = 0, Draws = 0, Losses = 0;
+
+	// Games stopped by an engine failure, they aren't results and stop the match
+	uint64_t Errors = 0;
+
+	// Time management of both engines over all games
+	std::chrono::nanoseconds Saved[2] = {}, Used[2] = {};
+
+	uint64_t GetGames() const { return Wins + Draws + Losses; }
+};
+
+// An engine instance owned by one worker, its tree is reused across games
+class Engine
+{
+public:
+	Engine(const EngineOptions &options, const SimulatorBackend &backend)
+		: m_TimeControl(options.TimeControl), m_Simulator(backend.Create(options.BatchSize, options.ThreadCount)),
+		m_Controller(GetControllerType(options.Backend), m_Simulator.get(), 1e9, options.Time, options.BatchSize, options.ExplorationConstant)
+	{
+		m_Controller.SetExpansion(options.Expansion);
+	}
+
+	Position MakeMove(Position position, const Clock &clock)
+	{
+		m_Controller.SetClock(clock);
+		return m_Controller.MakeMove(position);
+	}
+
+	const SearchReport &GetReport() const
+	{
+		return m_Controller.GetReport();
+	}
+
+	const TimeControl &GetTimeControl() const
+	{
+		return m_TimeControl;
+	}
+
+	// Of the last game
+	const TimeStats &GetTimeStats() const
+	{
+		return m_Controller.GetTimeStats();
+	}
+
+private:
+	TimeControl m_TimeControl;
+	std::unique_ptr<Simulator> m_Simulator;
+	ComputerController m_Controller;
+
+	static ControllerType GetControllerType(const std::string &backend)
+	{
+		if (backend == "threaded")
+			return ControllerType::ComputerThreadedHostController;
+		if (backend == "device")
+			return ControllerType::ComputerDeviceController;
+		return ControllerType::ComputerHostController;
+	}
+};
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: checkers_match --engine spec --engine spec [--games n] [--concurrency n] [--opening-plies n] [--seed n]\n"
+		<< "                      [--max-plies n] [--elo0 x] [--elo1 x] [--alpha x] [--beta x] [--record file]\n"
+		<< "                      [--telemetry file|-]\n"
+		<< "Engine spec: backend[,time=ms][,tc=base+increment][,batch=n][,threads=n][,c=x][,expand=n][,widen=x]\n"
+		<< "             e.g. threaded,time=200,batch=64,threads=2\n"
+		<< "Without tc every move targets time, with tc the engine has a clock (ms) and loses when it runs out\n";
+}
+
+static const SimulatorBackend *FindBackend(const std::string &name)
+{
+	for (const SimulatorBackend &backend : Simulator::GetBackends())
+		if (name == backend.Name)
+			return &backend;
+
+	return nullptr;
+}
+
+static bool ParseEngine(const char *spec, EngineOptions &engine)
+{
+	engine.Spec = spec;
+
+	std::stringstream stream(spec);
+	std::getline(stream, engine.Backend, ',');
+
+	for (std::string option; std::getline(stream, option, ',');)
+	{
+		const size_t separator = option.find('=');
+		if (separator == std::string::npos)
+			return false;
+
+		const std::string key = option.substr(0, separator);
+		const std::string value = option.substr(separator + 1);
+
+		if (key == "time")
+			engine.Time = std::chrono::milliseconds(std::stoul(value));
+		else if (key == "tc")
+		{
+			const size_t plus = value.find('+');
+			engine.TimeControl.Base = std::chrono::milliseconds(std::stoul(value.substr(0, plus)));
+			engine.TimeControl.Increment = std::chrono::milliseconds(plus == std::string::npos ? 0 : std::stoul(value.substr(plus + 1)));
+		}
+		else if (key == "batch")
+			engine.BatchSize = std::stoul(value);
+		else if (key == "threads")
+			engine.ThreadCount = std::stoul(value);
+		else if (key == "c")
+			engine.ExplorationConstant = std::stof(value);
+		else if (key == "expand")
+			engine.Expansion.Threshold = std::stoul(value);
+		else if (key == "widen")
+			engine.Expansion.WideningBase = std::stof(value);
+		else
+			return false;
+	}
+
+	return FindBackend(engine.Backend) != nullptr;
+}
+
+static double EloToScore(double elo)
+{
+	return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+static double ScoreToElo(double score)
+{
+	score = std::clamp(score, 1e-6, 1.0 - 1e-6);
+	return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+struct MatchSummary
+{
+	double Score;
+	double Elo, EloError;
+
+	// Generalized SPRT on the trinomial outcome (normal approximation of the log-likelihood ratio)
+	double LLR, LowerBound, UpperBound;
+};
+
+static MatchSummary Summarize(const MatchResult &result, const MatchOptions &options)
+{
+	MatchSummary summary = {
+		.LowerBound = std::log(options.Beta / (1.0 - options.Alpha)),
+		.UpperBound = std::log((1.0 - options.Beta) / options.Alpha)
+	};
+
+	const double games = (double)result.GetGames();
+	if (games == 0.0)
+		return summary;
+
+	const double wins = result.Wins / games, draws = result.Draws / games, losses = result.Losses / games;
+	summary.Score = wins + draws / 2.0;
+
+	const double variance = wins * std::pow(1.0 - summary.Score, 2) + draws * std::pow(0.5 - summary.Score, 2) + losses * std::pow(summary.Score, 2);
+	const double error = 1.96 * std::sqrt(variance / games);
+
+	summary.Elo = ScoreToElo(summary.Score);
+	summary.EloError = (ScoreToElo(summary.Score + error) - ScoreToElo(summary.Score - error)) / 2.0;
+
+	if (variance > 0.0)
+	{
+		const double score0 = EloToScore(options.Elo0), score1 = EloToScore(options.Elo1);
+		summary.LLR = games * (score1 - score0) * (2.0 * summary.Score - score0 - score1) / (2.0 * variance);
+	}
+
+	return summary;
+}
+
+static void PrintResult(const MatchResult &result, const MatchOptions &options, std::chrono::steady_clock::duration elapsed)
+{
+	const MatchSummary summary = Summarize(result, options);
+	const double hours = std::chrono::duration<double, std::ratio<3600>>(elapsed).count();
+
+	std::cout << std::format("Games {:>5}  W {:>4}  D {:>4}  L {:>4}  Elo {:+7.1f} +/- {:5.1f}  LLR {:+6.2f} [{:+.2f}, {:+.2f}]  {:.0f} games/h\n",
+		result.GetGames(), result.Wins, result.Draws, result.Losses, summary.Elo, summary.EloError,
+		summary.LLR, summary.LowerBound, summary.UpperBound, hours == 0.0 ? 0.0 : result.GetGames() / hours
+	) << std::flush;
+}
+
+// 1 if black won, -1 if white won, 0 for a draw
+static int PlayGame(Position position, Engine &black, Engine &white, int maxPlies, GameRecord &record)
+{
+	std::vector<Move> moves;
+
+	record.Start = position;
+	record.Result = GameResult::Draw;
+
+	std::chrono::nanoseconds clocks[2] = { black.GetTimeControl().Base, white.GetTimeControl().Base };
+
+	for (int ply = 0; ply < maxPlies; ply++)
+	{
+		if (position.HasLost())
+		{
+			record.Result = position.BlackTurn ? GameResult::WhiteWin : GameResult::BlackWin;
+			return position.BlackTurn ? -1 : 1;
+		}
+
+		if (position.IsDraw())
+			return 0;
+
+		Engine &engine = position.BlackTurn ? black : white;
+		const TimeControl &timeControl = engine.GetTimeControl();
+		std::chrono::nanoseconds &remaining = clocks[position.BlackTurn ? 0 : 1];
+
+		Clock clock = {
+			.MoveNumber = (size_t)ply / 2
+		};
+		if (timeControl.IsEnabled())
+		{
+			clock.Remaining = remaining;
+			clock.Increment = timeControl.Increment;
+		}
+
+		const std::chrono::time_point start(std::chrono::steady_clock::now());
+		const Position next = engine.MakeMove(position, clock);
+
+		if (timeControl.IsEnabled())
+		{
+			remaining -= std::chrono::steady_clock::now() - start;
+			if (remaining < std::chrono::nanoseconds(0))
+			{
+				record.Result = position.BlackTurn ? GameResult::WhiteWin : GameResult::BlackWin;
+				record.Termination = GameTermination::TimeForfeit;
+				return position.BlackTurn ? -1 : 1;
+			}
+
+			remaining += timeControl.Increment;
+		}
+
+		const SearchReport &report = engine.GetReport();
+		const float winRate = report.PrincipalVariation.empty() || report.PrincipalVariation.front().Visits == 0
+			? 0.5f : report.PrincipalVariation.front().Wins / (float)report.PrincipalVariation.front().Visits;
+
+		const int move = MoveGenerator::Find(position, next, moves);
+		if (move == -1)
+			throw std::logic_error(std::format("Engine returned an illegal move at ply {}", ply + 1));
+
+		record.Moves.push_back((uint16_t)move);
+		record.Stats.push_back(MoveStats{
+			.Simulations = (uint32_t)report.Simulations,
+			.WinRate = winRate,
+			.TimeMs = (uint32_t)(report.Time.count() / 1000)
+		});
+
+		position = next;
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	MatchOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(argv[i], "--engine") == 0 && hasValue)
+		{
+			EngineOptions engine;
+			if (!ParseEngine(argv[++i], engine))
+			{
+				std::cerr << "Invalid engine " << argv[i] << "\n";
+				PrintUsage();
+				return EXIT_FAILURE;
+			}
+			options.Engines.push_back(engine);
+		}
+		else if (std::strcmp(argv[i], "--games") == 0 && hasValue)
+			options.Games = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--concurrency") == 0 && hasValue)
+			options.Concurrency = std::max(std::strtoul(argv[++i], nullptr, 10), 1ul);
+		else if (std::strcmp(argv[i], "--opening-plies") == 0 && hasValue)
+			options.OpeningPlies = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+			options.Seed = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--max-plies") == 0 && hasValue)
+			options.MaxPlies = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--elo0") == 0 && hasValue)
+			options.Elo0 = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--elo1") == 0 && hasValue)
+			options.Elo1 = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--alpha") == 0 && hasValue)
+			options.Alpha = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--beta") == 0 && hasValue)
+			options.Beta = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--record") == 0 && hasValue)
+			options.RecordPath = argv[++i];
+		else if (std::strcmp(argv[i], "--telemetry") == 0 && hasValue)
+			options.TelemetryPath = argv[++i];
+		else
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (options.Engines.size() != 2)
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	std::cout << std::format("{} vs {}, {} games on {} workers, {} random opening plies\n",
+		options.Engines[0].Spec, options.Engines[1].Spec, options.Games, options.Concurrency, options.OpeningPlies
+	);
+
+	std::ofstream recordFile;
+	if (!options.RecordPath.empty())
+	{
+		recordFile.open(options.RecordPath, std::ios::binary | std::ios::app);
+		if (!recordFile)
+		{
+			std::cerr << "Can't open " << options.RecordPath << "\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!options.TelemetryPath.empty() && !Telemetry::Open(options.TelemetryPath))
+	{
+		std::cerr << "Can't open telemetry file " << options.TelemetryPath << "\n";
+		return EXIT_FAILURE;
+	}
+
+	MatchResult result;
+	std::mutex resultMutex;
+
+	std::atomic<unsigned int> nextGame = 0;
+	std::atomic<bool> stopped = false;
+
+	const std::chrono::time_point start(std::chrono::steady_clock::now());
+
+	// Every opening is played twice with colors swapped, so that unbalanced openings cancel out
+	auto work = [&]() {
+		Engine first(options.Engines[0], *FindBackend(options.Engines[0].Backend));
+		Engine second(options.Engines[1], *FindBackend(options.Engines[1].Backend));
+
+		for (unsigned int game = nextGame++; game < options.Games && !stopped; game = nextGame++)
+		{
+			PositionGenerator generator(options.Seed + game / 2);
+			const Position opening = generator.GenerateOpening(options.OpeningPlies);
+
+			const bool firstIsBlack = game % 2 == 0;
+
+			GameRecord record = {
+				.Tags = {
+					{ "Round", std::to_string(game + 1) },
+					{ "Black", firstIsBlack ? options.Engines[0].Spec : options.Engines[1].Spec },
+					{ "White", firstIsBlack ? options.Engines[1].Spec : options.Engines[0].Spec }
+				}
+			};
+
+			int outcome;
+			try
+			{
+				outcome = firstIsBlack
+					? PlayGame(opening, first, second, options.MaxPlies, record)
+					: -PlayGame(opening, second, first, options.MaxPlies, record);
+			}
+			catch (const std::exception &exception)
+			{
+				std::lock_guard lock(resultMutex);
+				result.Errors++;
+				stopped = true;
+
+				std::cerr << std::format("Game {} failed: {}\n", game + 1, exception.what());
+				continue;
+			}
+
+			std::lock_guard lock(resultMutex);
+
+			result.Saved[0] += first.GetTimeStats().Saved;
+			result.Used[0] += first.GetTimeStats().Used;
+			result.Saved[1] += second.GetTimeStats().Saved;
+			result.Used[1] += second.GetTimeStats().Used;
+
+			if (recordFile.is_open())
+			{
+				if (options.RecordPath.ends_with(".pdn"))
+					recordFile << Pdn::Write(record);
+				else
+					BinaryRecord::Write(recordFile, record);
+				recordFile.flush();
+			}
+
+			if (outcome == 1)
+				result.Wins++;
+			else if (outcome == -1)
+				result.Losses++;
+			else
+				result.Draws++;
+
+			PrintResult(result, options, std::chrono::steady_clock::now() - start);
+
+			const MatchSummary summary = Summarize(result, options);
+			if (summary.LLR <= summary.LowerBound || summary.LLR >= summary.UpperBound)
+				stopped = true;
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < options.Concurrency; i++)
+		workers.emplace_back(work);
+
+	for (std::thread &worker : workers)
+		worker.join();
+
+	// The last lines are written before the final report
+	Telemetry::Close();
+
+	const MatchSummary summary = Summarize(result, options);
+
+	std::cout << "\nFinal: ";
+	PrintResult(result, options, std::chrono::steady_clock::now() - start);
+
+	for (int i = 0; i < 2; i++)
+		std::cout << std::format("Engine {} time: used {:.1f} s, saved {:.1f} s ({:.2f} s per game)\n", i + 1,
+			result.Used[i].count() / 1e9, result.Saved[i].count() / 1e9, result.GetGames() == 0 ? 0.0 : result.Saved[i].count() / 1e9 / result.GetGames()
+		);
+
+	if (summary.LLR >= summary.UpperBound)
+		std::cout << std::format("SPRT: H1 accepted (Elo >= {})\n", options.Elo1);
+	else if (summary.LLR <= summary.LowerBound)
+		std::cout << std::format("SPRT: H0 accepted (Elo <= {})\n", options.Elo0);
+	else
+		std::cout << "SPRT: inconclusive\n";
+
+	if (result.Errors != 0)
+	{
+		std::cout << std::format("Errors: {} games failed, the match was stopped\n", result.Errors);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GameRecord.h"
+
+using namespace Checkers;
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: checkers_records convert <input> <output>\n"
+		<< "       checkers_records validate <file> [--threads n]\n"
+		<< "       checkers_records random <output> [--games n] [--seed n]\n"
+		<< "Files ending in .pdn are PDN, everything else is the binary record format\n";
+}
+
+static bool IsPdn(const std::string &path)
+{
+	return path.ends_with(".pdn") || path.ends_with(".PDN");
+}
+
+static std::vector<uint8_t> ReadFile(const std::string &path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		throw std::runtime_error(std::format("Can't open {}", path));
+
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static std::vector<GameRecord> ReadRecords(const std::string &path)
+{
+	std::vector<uint8_t> data = ReadFile(path);
+
+	if (IsPdn(path))
+		return Pdn::Read(std::string_view((const char *)data.data(), data.size()));
+
+	std::vector<GameRecord> records;
+	for (size_t offset = 0; offset < data.size();)
+	{
+		std::span<const uint8_t> record = std::span(data).subspan(offset);
+		offset += BinaryRecord::GetSize(record);
+		records.push_back(BinaryRecord::Read(record));
+	}
+
+	return records;
+}
+
+static void WriteRecords(const std::string &path, const std::vector<GameRecord> &records)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		throw std::runtime_error(std::format("Can't create {}", path));
+
+	for (const GameRecord &record : records)
+	{
+		if (IsPdn(path))
+			file << Pdn::Write(record);
+		else
+			BinaryRecord::Write(file, record);
+	}
+}
+
+static int Convert(const std::string &input, const std::string &output)
+{
+	const std::vector<GameRecord> records = ReadRecords(input);
+	WriteRecords(output, records);
+
+	std::cout << std::format("Converted {} games\n", records.size());
+	return EXIT_SUCCESS;
+}
+
+// Records are located by walking the headers, then replayed in parallel
+// PDN is validated while it's parsed, on one thread
+static int Validate(const std::string &path, unsigned int threadCount)
+{
+	const std::chrono::time_point start(std::chrono::steady_clock::now());
+
+	if (IsPdn(path))
+	{
+		std::vector<Move> moves;
+		for (const GameRecord &record : ReadRecords(path))
+			record.Replay(moves);
+
+		std::cout << std::format("PDN is valid, {:.3f} s\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		return EXIT_SUCCESS;
+	}
+
+	std::vector<uint8_t> data = ReadFile(path);
+
+	std::vector<size_t> offsets;
+	for (size_t offset = 0; offset < data.size(); offset += BinaryRecord::GetSize(std::span(data).subspan(offset)))
+		offsets.push_back(offset);
+
+	std::atomic<size_t> nextChunk = 0, invalid = 0;
+	std::atomic<uint64_t> moveCount = 0;
+	std::mutex errorMutex;
+
+	static constexpr size_t ChunkSize = 1024;
+
+	auto work = [&]() {
+		std::vector<Move> moves;
+		uint64_t localMoves = 0;
+
+		for (size_t chunk = nextChunk++; chunk * ChunkSize < offsets.size(); chunk = nextChunk++)
+		{
+			const size_t end = std::min((chunk + 1) * ChunkSize, offsets.size());
+			for (size_t i = chunk * ChunkSize; i < end; i++)
+			{
+				try
+				{
+					const GameRecord record = BinaryRecord::Read(std::span(data).subspan(offsets[i]));
+					record.Replay(moves);
+					localMoves += record.Moves.size();
+				}
+				catch (const std::exception &exception)
+				{
+					if (invalid++ < 10)
+					{
+						std::lock_guard lock(errorMutex);
+						std::cerr << std::format("Game {}: {}\n", i + 1, exception.what());
+					}
+				}
+			}
+		}
+
+		moveCount += localMoves;
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < threadCount; i++)
+		workers.emplace_back(work);
+	for (std::thread &worker : workers)
+		worker.join();
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << std::format("{} games, {} moves, {} invalid, {:.3f} s on {} threads, {:.3e} games/min\n",
+		offsets.size(), moveCount.load(), invalid.load(), seconds, threadCount, offsets.size() / seconds * 60
+	);
+
+	return invalid == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Uniformly random games, for testing the reader and the validator
+static int Random(const std::string &path, size_t gameCount, unsigned int seed)
+{
+	std::mt19937 engine(seed);
+	std::vector<Move> moves;
+
+	std::vector<GameRecord> records(gameCount);
+	for (GameRecord &record : records)
+	{
+		Position position = record.Start;
+		while (!position.HasLost() && !position.IsDraw())
+		{
+			MoveGenerator::Generate(position, moves);
+
+			const uint16_t move = std::uniform_int_distribution<size_t>(0, moves.size() - 1)(engine);
+			record.Moves.push_back(move);
+			position = moves[move].Position;
+		}
+
+		if (position.HasLost())
+			record.Result = position.BlackTurn ? GameResult::WhiteWin : GameResult::BlackWin;
+		else
+			record.Result = GameResult::Draw;
+	}
+
+	WriteRecords(path, records);
+
+	std::cout << std::format("Wrote {} games\n", records.size());
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	const std::string command = argv[1];
+
+	unsigned int threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	size_t gameCount = 100000;
+	unsigned int seed = 1;
+
+	for (int i = command == "convert" ? 4 : 3; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+			threadCount = std::max(std::strtoul(argv[++i], nullptr, 10), 1ul);
+		else if (std::strcmp(argv[i], "--games") == 0 && hasValue)
+			gameCount = std::strtoull(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+			seed = std::strtoul(argv[++i], nullptr, 10);
+		else
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	try
+	{
+		if (command == "convert" && argc >= 4)
+			return Convert(argv[2], argv[3]);
+		if (command == "validate")
+			return Validate(argv[2], threadCount);
+		if (command == "random")
+			return Random(argv[2], gameCount, seed);
+	}
+	catch (const std::exception &exception)
+	{
+		std::cerr << exception.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	PrintUsage();
+	return EXIT_FAILURE;
+}
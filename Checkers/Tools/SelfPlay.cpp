@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Controllers/MCTS.h"
+#include "Core/Telemetry.h"
+#include "PositionGenerator.h"
+#include "TrainingData.h"
+
+using namespace Checkers;
+
+struct SelfPlayOptions
+{
+	std::string Directory;
+	std::string Backend = "host";
+	unsigned int BatchSize = 1;
+	unsigned int ThreadCount = 1;
+	float ExplorationConstant = Tree::DefaultExplorationConstant;
+
+	// Root simulations per move, the time limit only guards against a slow simulator
+	uint64_t Simulations = 800;
+	std::chrono::milliseconds MaxTime = std::chrono::milliseconds(10000);
+
+	// 0 - until interrupted
+	uint64_t Games = 0;
+	unsigned int Concurrency = std::max(std::thread::hardware_concurrency(), 1u);
+	unsigned int Seed = 1;
+	int OpeningPlies = 4;
+	int MaxPlies = 400;
+
+	// Moves are drawn in proportion to the visits for this many plies, after that the most visited move is played
+	int SamplePlies = 16;
+
+	size_t ShardSize = TrainingShard::DefaultSize;
+	std::chrono::seconds ReportInterval = std::chrono::seconds(10);
+
+	// One JSON line per searched move, "-" for stdout
+	std::string TelemetryPath = {};
+};
+
+// Set by SIGINT and SIGTERM, running searches end early and their games are dropped
+static std::atomic<bool> s_Stop = false;
+
+static void OnSignal(int)
+{
+	s_Stop = true;
+}
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: checkers_selfplay <directory> [--backend name] [--batch n] [--threads n] [--c x] [--simulations n]\n"
+		<< "                         [--games n] [--concurrency n] [--seed n] [--opening-plies n] [--sample-plies n]\n"
+		<< "                         [--max-plies n] [--shard-size bytes] [--report s] [--telemetry file|-]\n"
+		<< "       checkers_selfplay verify <directory> [--threads n]\n"
+		<< "A run continues after the shards already in the directory, SIGINT writes out the games played so far\n";
+}
+
+static const SimulatorBackend *FindBackend(const std::string &name)
+{
+	for (const SimulatorBackend &backend : Simulator::GetBackends())
+		if (name == backend.Name)
+			return &backend;
+
+	return nullptr;
+}
+
+// Returns false if the game was interrupted
+static bool PlayGame(Tree &tree, const SearchLimits &limits, const SelfPlayOptions &options, TrainingGame &game)
+{
+	PositionGenerator generator(options.Seed + game.Index);
+	std::mt19937 engine(options.Seed ^ (unsigned int)(game.Index * 0x9e3779b9u));
+
+	game.Start = generator.GenerateOpening(options.OpeningPlies);
+	game.Result = GameResult::Draw;
+
+	std::vector<Move> moves;
+
+	Position position = game.Start;
+	for (int ply = 0; ply < options.MaxPlies; ply++)
+	{
+		if (position.HasLost())
+		{
+			game.Result = position.BlackTurn ? GameResult::WhiteWin : GameResult::BlackWin;
+			break;
+		}
+
+		if (position.IsDraw())
+			break;
+
+		MoveGenerator::Generate(position, moves);
+
+		if (moves.size() == 1)
+		{
+			game.Moves.push_back(0);
+			game.Visits.emplace_back();
+			position = moves.front().Position;
+			continue;
+		}
+
+		tree.FindBestMove(position, {}, limits);
+		if (s_Stop)
+			return false;
+
+		if (Telemetry::IsEnabled())
+			Telemetry::Write(tree.GetReport().ToJson());
+
+		// The tree keeps one child per distinct position, in the order of the first move leading to it
+		// Moves that repeat an earlier position get no visits
+		std::vector<size_t> distinct;
+		for (size_t i = 0; i < moves.size(); i++)
+			if (std::none_of(distinct.begin(), distinct.end(), [&](size_t index) { return moves[index].Position == moves[i].Position; }))
+				distinct.push_back(i);
+
+		const std::vector<SearchMove> &rootMoves = tree.GetReport().RootMoves;
+		if (rootMoves.size() != distinct.size())
+			throw std::logic_error(std::format("Tree has {} root moves, the move generator {} distinct ones", rootMoves.size(), distinct.size()));
+
+		std::vector<uint32_t> &visits = game.Visits.emplace_back(moves.size());
+		for (size_t i = 0; i < distinct.size(); i++)
+			visits[distinct[i]] = rootMoves[i].Visits;
+
+		size_t choice = std::max_element(visits.begin(), visits.end()) - visits.begin();
+		if (ply < options.SamplePlies && visits[choice] != 0)
+			choice = std::discrete_distribution<size_t>(visits.begin(), visits.end())(engine);
+
+		game.Moves.push_back(choice);
+		position = moves[choice].Position;
+	}
+
+	return true;
+}
+
+static int Run(const SelfPlayOptions &options)
+{
+	const SimulatorBackend *backend = FindBackend(options.Backend);
+	if (backend == nullptr)
+	{
+		std::cerr << "Unknown backend " << options.Backend << "\n";
+		return EXIT_FAILURE;
+	}
+
+	ShardWriter writer(options.Directory, options.ShardSize);
+
+	const ShardWriter::Contents &resumed = writer.GetResumed();
+	if (resumed.Shards != 0 || resumed.Corrupt != 0)
+		std::cout << std::format("Resuming after {} shards ({} games, {} positions), {} temporary files removed, {} corrupt shards set aside\n",
+			resumed.Shards, resumed.Games, resumed.Samples, resumed.Removed, resumed.Corrupt
+		);
+
+	std::signal(SIGINT, OnSignal);
+	std::signal(SIGTERM, OnSignal);
+
+	const uint64_t lastGame = options.Games == 0 ? UINT64_MAX : resumed.NextGame + options.Games;
+	std::atomic<uint64_t> nextGame = resumed.NextGame;
+	std::atomic<uint64_t> games = 0, positions = 0;
+
+	std::mutex doneMutex;
+	std::condition_variable doneChanged;
+	unsigned int running = options.Concurrency;
+	std::exception_ptr error = nullptr;
+
+	auto work = [&]() {
+		try
+		{
+			std::unique_ptr<Simulator> simulator(backend->Create(options.BatchSize, options.ThreadCount));
+			Tree tree(simulator.get(), UINT_MAX, options.MaxTime, options.BatchSize, options.ExplorationConstant);
+			tree.SetSubtreeReuse(true);
+
+			SearchLimits limits = tree.GetDefaultLimits();
+			limits.Simulations = options.Simulations;
+			limits.Stop = &s_Stop;
+
+			for (uint64_t index = nextGame++; index < lastGame && !s_Stop; index = nextGame++)
+			{
+				TrainingGame game = { .Index = index };
+				if (!PlayGame(tree, limits, options, game))
+					break;
+
+				writer.Add(game);
+
+				games++;
+				positions += game.GetSampleCount();
+			}
+		}
+		catch (const std::exception &)
+		{
+			std::lock_guard lock(doneMutex);
+			error = std::current_exception();
+			s_Stop = true;
+		}
+
+		std::lock_guard lock(doneMutex);
+		running--;
+		doneChanged.notify_all();
+	};
+
+	std::cout << std::format("Self-play into {} with {} workers, {} simulations per move, backend {}\n",
+		options.Directory, options.Concurrency, options.Simulations, options.Backend
+	) << std::flush;
+
+	const std::chrono::time_point start(std::chrono::steady_clock::now());
+
+	if (!options.TelemetryPath.empty() && !Telemetry::Open(options.TelemetryPath))
+	{
+		std::cerr << "Can't open telemetry file " << options.TelemetryPath << "\n";
+		return EXIT_FAILURE;
+	}
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < options.Concurrency; i++)
+		workers.emplace_back(work);
+
+	auto report = [&]() {
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		const ShardWriter::Stats stats = writer.GetStats();
+
+		std::cout << std::format("Games {}  positions {}  {:.1f} positions/s  shards {} ({:.1f} MiB)  writer stalls {:.3f} s\n",
+			games.load(), positions.load(), seconds == 0.0 ? 0.0 : positions / seconds,
+			stats.Shards, stats.Bytes / 1048576.0, std::chrono::duration<double>(stats.Stalled).count()
+		) << std::flush;
+	};
+
+	{
+		std::unique_lock lock(doneMutex);
+		while (!doneChanged.wait_for(lock, options.ReportInterval, [&] { return running == 0; }))
+		{
+			lock.unlock();
+			report();
+			lock.lock();
+		}
+	}
+
+	for (std::thread &worker : workers)
+		worker.join();
+
+	Telemetry::Close();
+	writer.Close();
+	report();
+
+	if (error)
+		std::rethrow_exception(error);
+
+	return EXIT_SUCCESS;
+}
+
+// Checks the checksums and replays every game, shards are verified in parallel
+static int Verify(const std::string &directory, unsigned int threadCount)
+{
+	const std::chrono::time_point start(std::chrono::steady_clock::now());
+	const std::vector<std::filesystem::path> shards = ShardWriter::GetShards(directory);
+
+	std::atomic<size_t> nextShard = 0, invalid = 0;
+	std::atomic<uint64_t> gameCount = 0, sampleCount = 0;
+	std::mutex errorMutex;
+
+	auto work = [&]() {
+		std::vector<TrainingSample> samples;
+		std::vector<Move> moves;
+
+		for (size_t i = nextShard++; i < shards.size(); i = nextShard++)
+		{
+			try
+			{
+				std::ifstream file(shards[i], std::ios::binary);
+				const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+				const std::vector<TrainingGame> games = TrainingShard::Read(data);
+				for (const TrainingGame &game : games)
+				{
+					samples.clear();
+					GetSamples(game, samples, moves);
+					sampleCount += samples.size();
+				}
+				gameCount += games.size();
+			}
+			catch (const std::exception &exception)
+			{
+				invalid++;
+
+				std::lock_guard lock(errorMutex);
+				std::cerr << std::format("{}: {}\n", shards[i].string(), exception.what());
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < threadCount; i++)
+		workers.emplace_back(work);
+	for (std::thread &worker : workers)
+		worker.join();
+
+	std::cout << std::format("{} shards, {} invalid, {} games, {} positions, {:.3f} s\n",
+		shards.size(), invalid.load(), gameCount.load(), sampleCount.load(),
+		std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+	);
+
+	return invalid == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	const bool verify = std::strcmp(argv[1], "verify") == 0;
+	if (verify && argc < 3)
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	SelfPlayOptions options;
+	options.Directory = argv[verify ? 2 : 1];
+
+	unsigned int verifyThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (int i = verify ? 3 : 2; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(argv[i], "--backend") == 0 && hasValue)
+			options.Backend = argv[++i];
+		else if (std::strcmp(argv[i], "--batch") == 0 && hasValue)
+			options.BatchSize = std::max(std::strtoul(argv[++i], nullptr, 10), 1ul);
+		else if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+			options.ThreadCount = verifyThreads = std::max(std::strtoul(argv[++i], nullptr, 10), 1ul);
+		else if (std::strcmp(argv[i], "--c") == 0 && hasValue)
+			options.ExplorationConstant = std::strtof(argv[++i], nullptr);
+		else if (std::strcmp(argv[i], "--simulations") == 0 && hasValue)
+			options.Simulations = std::max(std::strtoull(argv[++i], nullptr, 10), 1ull);
+		else if (std::strcmp(argv[i], "--games") == 0 && hasValue)
+			options.Games = std::strtoull(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--concurrency") == 0 && hasValue)
+			options.Concurrency = std::max(std::strtoul(argv[++i], nullptr, 10), 1ul);
+		else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+			options.Seed = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--opening-plies") == 0 && hasValue)
+			options.OpeningPlies = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--sample-plies") == 0 && hasValue)
+			options.SamplePlies = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--max-plies") == 0 && hasValue)
+			options.MaxPlies = std::atoi(argv[++i]);
+		else if (std::strcmp(argv[i], "--shard-size") == 0 && hasValue)
+			options.ShardSize = std::strtoull(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--report") == 0 && hasValue)
+			options.ReportInterval = std::chrono::seconds(std::max(std::strtoul(argv[++i], nullptr, 10), 1ul));
+		else if (std::strcmp(argv[i], "--telemetry") == 0 && hasValue)
+			options.TelemetryPath = argv[++i];
+		else
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	try
+	{
+		if (verify)
+			return Verify(options.Directory, verifyThreads);
+		return Run(options);
+	}
+	catch (const std::exception &exception)
+	{
+		std::cerr << exception.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+}
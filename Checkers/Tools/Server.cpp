@@ -0,0 +1,575 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define CHECKERS_HAS_UNIX_SOCKETS
+#endif
+
+#include "Controllers/BatchingSimulator.h"
+#include "Controllers/ComputerController.h"
+#include "Core/Telemetry.h"
+#include "SessionManager.h"
+
+using namespace Checkers;
+
+struct ServerOptions
+{
+	std::string Backend = "threaded";
+	unsigned int BatchSize = 256;
+
+	// Playout threads of the threaded backend or threads per block of the device one, 0 for the default of the backend
+	unsigned int ThreadCount = 0;
+
+	// Concurrent searches and the leaves each of them selects per iteration
+	unsigned int Workers = 16;
+	unsigned int SelectCount = 16;
+
+	// Workers playing the moves of the games hosted with the game command
+	unsigned int GameWorkers = 4;
+
+	std::chrono::microseconds MaxDelay = std::chrono::microseconds(500);
+	std::chrono::milliseconds Budget = std::chrono::milliseconds(100);
+	std::chrono::milliseconds StatsInterval = std::chrono::milliseconds(1000);
+
+	std::string SocketPath = {};
+
+	// "-" sends the lines as telemetry <json> with the responses when they go to stdout
+	std::string TelemetryPath = {};
+};
+
+// Source of request lines and sink of responses, responses come from the worker threads
+class Connection
+{
+public:
+	virtual ~Connection() = default;
+
+	virtual bool ReadLine(std::string &line) = 0;
+	virtual void WriteLine(const std::string &line) = 0;
+};
+
+class StdioConnection : public Connection
+{
+public:
+	bool ReadLine(std::string &line) override
+	{
+		return (bool)std::getline(std::cin, line);
+	}
+
+	void WriteLine(const std::string &line) override
+	{
+		std::lock_guard lock(m_Mutex);
+		std::cout << line << '\n' << std::flush;
+	}
+
+private:
+	std::mutex m_Mutex;
+};
+
+#ifdef CHECKERS_HAS_UNIX_SOCKETS
+class SocketConnection : public Connection
+{
+public:
+	SocketConnection(int fd) : m_Fd(fd) {}
+	~SocketConnection() override { close(m_Fd); }
+
+	bool ReadLine(std::string &line) override
+	{
+		while (true)
+		{
+			const size_t end = m_Buffer.find('\n');
+			if (end != std::string::npos)
+			{
+				line = m_Buffer.substr(0, end);
+				m_Buffer.erase(0, end + 1);
+				return true;
+			}
+
+			char data[4096];
+			const ssize_t count = read(m_Fd, data, sizeof(data));
+			if (count <= 0)
+				return false;
+
+			m_Buffer.append(data, count);
+		}
+	}
+
+	void WriteLine(const std::string &line) override
+	{
+		const std::string data = line + '\n';
+
+		std::lock_guard lock(m_Mutex);
+		for (size_t written = 0; written < data.size();)
+		{
+			const ssize_t count = write(m_Fd, data.data() + written, data.size() - written);
+			if (count <= 0)
+				return;
+			written += count;
+		}
+	}
+
+private:
+	const int m_Fd;
+	std::string m_Buffer;
+	std::mutex m_Mutex;
+};
+#endif
+
+struct Job
+{
+	std::shared_ptr<Connection> Client;
+	std::string Id;
+	Checkers::Position Position;
+
+	std::chrono::milliseconds Budget;
+	std::chrono::steady_clock::time_point Received;
+};
+
+class Server
+{
+public:
+	Server(const ServerOptions &options, const SimulatorBackend &backend)
+		: m_Options(options), m_Batcher(backend.Create(options.BatchSize, options.ThreadCount), options.BatchSize, options.MaxDelay),
+		m_Games(options.GameWorkers, [this](ControllerType type, bool black) { return CreateGameController(type, black); })
+	{
+		for (unsigned int i = 0; i < options.Workers; i++)
+			m_Workers.emplace_back(&Server::WorkerLoop, this);
+
+		m_StatsThread = std::thread(&Server::StatsLoop, this);
+	}
+
+	~Server()
+	{
+		{
+			std::lock_guard lock(m_Mutex);
+			m_Stopping = true;
+		}
+		m_JobQueued.notify_all();
+		m_StopRequested.notify_all();
+
+		for (std::thread &worker : m_Workers)
+			worker.join();
+		m_StatsThread.join();
+	}
+
+	// With endGames the games started by the client are ended once it disconnects
+	void Serve(std::shared_ptr<Connection> client, bool endGames = false)
+	{
+		std::vector<SessionId> games;
+
+		for (std::string line; client->ReadLine(line);)
+		{
+			std::istringstream stream(line);
+
+			std::string command;
+			if (!(stream >> command))
+				continue;
+
+			if (command == "quit")
+				break;
+			else if (command == "stats")
+				client->WriteLine(FormatStats());
+			else if (command == "eval")
+			{
+				Job job = { .Client = client, .Budget = m_Options.Budget, .Received = std::chrono::steady_clock::now() };
+				if (!ParseJob(stream, job))
+				{
+					client->WriteLine("error invalid request " + line);
+					continue;
+				}
+
+				{
+					std::lock_guard lock(m_Mutex);
+					m_Jobs.push_back(std::move(job));
+				}
+				m_JobQueued.notify_one();
+			}
+			else if (command == "game")
+			{
+				// The starting position unless one is given
+				Position position = StartingPosition;
+				stream >> std::ws;
+				if (!stream.eof() && !ParsePosition(stream, position))
+				{
+					client->WriteLine("error invalid request " + line);
+					continue;
+				}
+
+				const SessionId id = m_Games.Create(ControllerType::ComputerHostController, ControllerType::ComputerHostController, position,
+					[this, client](SessionId game, const GameSession &session) { OnGameMove(*client, game, session); }
+				);
+				games.push_back(id);
+				client->WriteLine(std::format("game {} started", id));
+			}
+			else if (command == "endgame")
+			{
+				SessionId id;
+				if (!(stream >> id) || m_Games.Get(id) == nullptr)
+				{
+					client->WriteLine("error unknown game " + line);
+					continue;
+				}
+
+				m_Games.Remove(id);
+				client->WriteLine(std::format("gameover {} ended", id));
+			}
+			else
+				client->WriteLine("error unknown command " + command);
+		}
+
+		if (endGames)
+			for (SessionId id : games)
+				m_Games.Remove(id);
+	}
+
+	// Waits until every queued request is answered
+	void Drain()
+	{
+		{
+			std::unique_lock lock(m_Mutex);
+			m_JobDone.wait(lock, [&] { return m_Jobs.empty() && m_Searching == 0; });
+		}
+
+		m_Games.WaitAll();
+	}
+
+	std::string FormatStats()
+	{
+		const BatchingStats stats = m_Batcher.GetStats();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_Start).count();
+
+		size_t queuedJobs;
+		{
+			std::lock_guard lock(m_Mutex);
+			queuedJobs = m_Jobs.size();
+		}
+
+		return std::format("stats queue {} searching {} games {} queued_positions {} batches {} fill {:.3f} positions/s {:.0f} requests/s {:.1f}",
+			queuedJobs, m_Searching.load(), m_Games.GetSessionCount(), stats.QueuedPositions, stats.Batches, stats.FillRatio,
+			stats.Positions / seconds, m_Completed.load() / seconds
+		);
+	}
+
+private:
+	const ServerOptions m_Options;
+	SimulationBatcher m_Batcher;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_JobQueued;
+	std::condition_variable m_JobDone;
+	std::condition_variable m_StopRequested;
+	std::deque<Job> m_Jobs;
+	bool m_Stopping = false;
+
+	std::atomic<unsigned int> m_Searching = 0;
+	std::atomic<uint64_t> m_Completed = 0;
+	const std::chrono::steady_clock::time_point m_Start = std::chrono::steady_clock::now();
+
+	// Games share the batcher with the eval requests, declared after it so that they end first
+	SessionManager m_Games;
+
+	std::vector<std::thread> m_Workers;
+	std::thread m_StatsThread;
+
+	// <black> <white> <queens> <b|w> <sinceCapture>, bitboards in hex
+	static bool ParsePosition(std::istringstream &stream, Position &position)
+	{
+		std::string black, white, queens, turn;
+		int sinceCapture = 0;
+		if (!(stream >> black >> white >> queens >> turn >> sinceCapture) || (turn != "b" && turn != "w"))
+			return false;
+
+		try
+		{
+			position = Position{
+				(Bitboard)std::stoul(black, nullptr, 16), (Bitboard)std::stoul(white, nullptr, 16),
+				(Bitboard)std::stoul(queens, nullptr, 16), (int8_t)sinceCapture, turn == "b"
+			};
+		}
+		catch (const std::exception &)
+		{
+			return false;
+		}
+
+		return (position.Black & position.White) == 0;
+	}
+
+	static std::string FormatPosition(const Position &position)
+	{
+		return std::format("{:x} {:x} {:x} {} {}", position.Black, position.White, position.Queens, position.BlackTurn ? "b" : "w", (int)position.SinceCapture);
+	}
+
+	// eval <id> <position> [budgetMs]
+	static bool ParseJob(std::istringstream &stream, Job &job)
+	{
+		if (!(stream >> job.Id) || !ParsePosition(stream, job.Position))
+			return false;
+
+		unsigned int budget;
+		if (stream >> budget)
+			job.Budget = std::chrono::milliseconds(budget);
+
+		return true;
+	}
+
+	// Every side of a game searches for the request budget on its own client of the batcher
+	std::unique_ptr<Controller> CreateGameController(ControllerType type, bool black)
+	{
+		std::unique_ptr<Simulator> client(m_Batcher.CreateClient(black ? "Game black" : "Game white"));
+		return std::make_unique<ComputerController>(type, std::move(client), 1e9, m_Options.Budget, m_Options.SelectCount);
+	}
+
+	void OnGameMove(Connection &client, SessionId id, const GameSession &session)
+	{
+		const SessionState state = session.GetState();
+		if (!state.Finished)
+		{
+			client.WriteLine(std::format("move {} {} {}", id, state.MoveCount, FormatPosition(state.Position)));
+			return;
+		}
+
+		static constexpr const char *Results[] = { "unfinished", "white", "black", "draw" };
+		client.WriteLine(std::format("gameover {} {} moves {}", id, Results[(size_t)state.Result], state.MoveCount));
+
+		// Finished games are dropped right away, the worker holds this one until the callback returns
+		m_Games.Remove(id);
+	}
+
+	void WorkerLoop()
+	{
+		std::unique_ptr<Simulator> simulator(m_Batcher.CreateClient());
+		ComputerController controller(ControllerType::ComputerHostController, simulator.get(), 1e9, m_Options.Budget, m_Options.SelectCount);
+
+		std::unique_lock lock(m_Mutex);
+		while (true)
+		{
+			m_JobQueued.wait(lock, [&] { return m_Stopping || !m_Jobs.empty(); });
+
+			if (m_Stopping)
+				return;
+
+			Job job = std::move(m_Jobs.front());
+			m_Jobs.pop_front();
+			m_Searching++;
+
+			lock.unlock();
+			job.Client->WriteLine(Evaluate(controller, job));
+			lock.lock();
+
+			m_Searching--;
+			m_Completed++;
+			m_JobDone.notify_all();
+		}
+	}
+
+	static std::string Evaluate(ComputerController &controller, const Job &job)
+	{
+		if (job.Position.HasLost() || job.Position.IsDraw())
+			return std::format("result {} none", job.Id);
+
+		// Time spent in the queue counts against the budget, one millisecond is left for the last batch
+		const auto waited = std::chrono::steady_clock::now() - job.Received;
+		SearchLimits limits = controller.GetDefaultLimits();
+		limits.Time = std::max<std::chrono::nanoseconds>(job.Budget - waited - std::chrono::milliseconds(1), std::chrono::milliseconds(1));
+
+		controller.MakeMove(job.Position, limits);
+		const SearchReport &report = controller.GetReport();
+
+		const double latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job.Received).count();
+		if (report.PrincipalVariation.empty())
+			return std::format("result {} none latency {:.2f}", job.Id, latency);
+
+		const SearchMove &best = report.PrincipalVariation.front();
+		return std::format("result {} bestmove {}-{} winrate {:.4f} simulations {} latency {:.2f}",
+			job.Id, best.From, best.To, best.Visits == 0 ? 0.0 : best.Wins / (double)best.Visits, report.Simulations, latency
+		);
+	}
+
+	void StatsLoop()
+	{
+		std::unique_lock lock(m_Mutex);
+		while (!m_Stopping)
+		{
+			m_StopRequested.wait_for(lock, m_Options.StatsInterval, [&] { return m_Stopping; });
+			if (m_Stopping)
+				return;
+
+			lock.unlock();
+			std::cerr << FormatStats() << std::endl;
+			lock.lock();
+		}
+	}
+};
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: checkers_server [--backend name] [--batch n] [--threads n] [--workers n] [--select n] [--delay us]\n"
+		<< "                       [--budget ms] [--games n] [--stats ms] [--socket path] [--telemetry file|-]\n";
+}
+
+static const SimulatorBackend *FindBackend(const std::string &name)
+{
+	for (const SimulatorBackend &backend : Simulator::GetBackends())
+		if (name == backend.Name)
+			return &backend;
+
+	return nullptr;
+}
+
+#ifdef CHECKERS_HAS_UNIX_SOCKETS
+static int ServeSocket(Server &server, const std::string &path)
+{
+	const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (listener == -1 || path.size() >= sizeof(address.sun_path))
+	{
+		std::cerr << "Can't create socket " << path << "\n";
+		return EXIT_FAILURE;
+	}
+	std::strcpy(address.sun_path, path.c_str());
+
+	// The socket of an earlier run is replaced, any other file is left alone
+	struct stat status;
+	if (lstat(path.c_str(), &status) == 0)
+	{
+		if (!S_ISSOCK(status.st_mode))
+		{
+			std::cerr << path << " exists and isn't a socket\n";
+			close(listener);
+			return EXIT_FAILURE;
+		}
+
+		unlink(path.c_str());
+	}
+
+	if (bind(listener, (sockaddr *)&address, sizeof(address)) == -1 || listen(listener, 64) == -1)
+	{
+		std::cerr << "Can't listen on socket " << path << "\n";
+		close(listener);
+		return EXIT_FAILURE;
+	}
+
+	// One reader thread per client, the server runs until the process is killed
+	while (true)
+	{
+		const int fd = accept(listener, nullptr, nullptr);
+		if (fd == -1)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+
+			// Out of descriptors or memory, retrying right away would spin until clients disconnect
+			if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+				continue;
+			}
+
+			std::cerr << "Can't accept on socket " << path << ": " << std::strerror(errno) << "\n";
+			close(listener);
+			return EXIT_FAILURE;
+		}
+
+		std::thread([&server, fd]() {
+			server.Serve(std::make_shared<SocketConnection>(fd), true);
+		}).detach();
+	}
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+	ServerOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(argv[i], "--backend") == 0 && hasValue)
+			options.Backend = argv[++i];
+		else if (std::strcmp(argv[i], "--batch") == 0 && hasValue)
+			options.BatchSize = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+			options.ThreadCount = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "--workers") == 0 && hasValue)
+			options.Workers = std::max(std::strtoul(argv[++i], nullptr, 10), 1ul);
+		else if (std::strcmp(argv[i], "--select") == 0 && hasValue)
+			options.SelectCount = std::max(std::strtoul(argv[++i], nullptr, 10), 1ul);
+		else if (std::strcmp(argv[i], "--delay") == 0 && hasValue)
+			options.MaxDelay = std::chrono::microseconds(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--budget") == 0 && hasValue)
+			options.Budget = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--games") == 0 && hasValue)
+			options.GameWorkers = std::max(std::strtoul(argv[++i], nullptr, 10), 1ul);
+		else if (std::strcmp(argv[i], "--stats") == 0 && hasValue)
+			options.StatsInterval = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--socket") == 0 && hasValue)
+			options.SocketPath = argv[++i];
+		else if (std::strcmp(argv[i], "--telemetry") == 0 && hasValue)
+			options.TelemetryPath = argv[++i];
+		else
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	const SimulatorBackend *backend = FindBackend(options.Backend);
+	if (backend == nullptr)
+	{
+		std::cerr << "Unknown backend " << options.Backend << "\n";
+		return EXIT_FAILURE;
+	}
+
+	// Responses on stdout and telemetry share the connection, so that their lines don't interleave
+	const std::shared_ptr<StdioConnection> stdio = std::make_shared<StdioConnection>();
+	if (options.TelemetryPath == "-" && options.SocketPath.empty())
+		Telemetry::Open([stdio](std::string_view line) { stdio->WriteLine(std::format("telemetry {}", line)); });
+	else if (!options.TelemetryPath.empty() && !Telemetry::Open(options.TelemetryPath))
+	{
+		std::cerr << "Can't open telemetry file " << options.TelemetryPath << "\n";
+		return EXIT_FAILURE;
+	}
+
+	Server server(options, *backend);
+
+	if (!options.SocketPath.empty())
+	{
+#ifdef CHECKERS_HAS_UNIX_SOCKETS
+		const int result = ServeSocket(server, options.SocketPath);
+#else
+		std::cerr << "Unix sockets are not supported on this platform\n";
+		const int result = EXIT_FAILURE;
+#endif
+		Telemetry::Close();
+		return result;
+	}
+
+	server.Serve(stdio);
+
+	// Requests read before the end of input are still answered
+	server.Drain();
+	Telemetry::Close();
+
+	std::cerr << server.FormatStats() << std::endl;
+
+	return EXIT_SUCCESS;
+}
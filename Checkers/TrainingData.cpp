@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+
+#include "Core/Serialization.h"
+#include "TrainingData.h"
+
+namespace Checkers
+{
+
+size_t TrainingGame::GetSampleCount() const
+{
+	return std::count_if(Visits.begin(), Visits.end(), [](const std::vector<uint32_t> &visits) { return !visits.empty(); });
+}
+
+void GetSamples(const TrainingGame &game, std::vector<TrainingSample> &samples, std::vector<Move> &moves)
+{
+	if (game.Visits.size() != game.Moves.size())
+		throw std::runtime_error("Visits don't match the moves");
+
+	const GameRecord record = { .Start = game.Start, .Moves = game.Moves, .Result = game.Result };
+	record.Replay(moves);
+
+	Position position = game.Start;
+	for (size_t i = 0; i < game.Moves.size(); i++)
+	{
+		MoveGenerator::Generate(position, moves);
+
+		const std::vector<uint32_t> &visits = game.Visits[i];
+		if (!visits.empty())
+		{
+			if (visits.size() != moves.size())
+				throw std::runtime_error(std::format("Move {} has visits for {} of {} legal moves", i + 1, visits.size(), moves.size()));
+
+			int value = 0;
+			if (game.Result == GameResult::BlackWin)
+				value = position.BlackTurn ? 1 : -1;
+			else if (game.Result == GameResult::WhiteWin)
+				value = position.BlackTurn ? -1 : 1;
+
+			samples.push_back(TrainingSample{ position, visits, value });
+		}
+
+		position = moves[game.Moves[i]].Position;
+	}
+}
+
+TrainingShard::TrainingShard(size_t size)
+	: m_Size(size)
+{
+	if (size <= HeaderSize || size > UINT32_MAX)
+		throw std::length_error(std::format("Invalid shard size {}", size));
+
+	Clear();
+}
+
+bool TrainingShard::Add(const TrainingGame &game)
+{
+	m_Entry.clear();
+	WriteVarint(m_Entry, game.Index);
+	WriteUint32(m_Entry, game.Start.Black);
+	WriteUint32(m_Entry, game.Start.White);
+	WriteUint32(m_Entry, game.Start.Queens);
+	m_Entry.push_back((char)game.Start.SinceCapture);
+	m_Entry.push_back((char)game.Start.BlackTurn);
+	m_Entry.push_back((char)game.Result);
+	WriteVarint(m_Entry, game.Moves.size());
+
+	for (size_t i = 0; i < game.Moves.size(); i++)
+	{
+		WriteVarint(m_Entry, game.Moves[i]);
+		WriteVarint(m_Entry, game.Visits[i].size());
+		for (uint32_t visits : game.Visits[i])
+			WriteVarint(m_Entry, visits);
+	}
+
+	if (HeaderSize + m_Entry.size() > m_Size)
+		throw std::length_error(std::format("Game of {} bytes doesn't fit into a shard of {} bytes", m_Entry.size(), m_Size));
+
+	if (m_Data.size() + m_Entry.size() > m_Size)
+		return false;
+
+	m_Data += m_Entry;
+
+	m_MinGame = m_GameCount == 0 ? game.Index : std::min(m_MinGame, game.Index);
+	m_MaxGame = m_GameCount == 0 ? game.Index : std::max(m_MaxGame, game.Index);
+	m_GameCount++;
+	m_SampleCount += game.GetSampleCount();
+
+	return true;
+}
+
+void TrainingShard::Clear()
+{
+	m_Data.assign(HeaderSize, 0);
+	m_Data.reserve(m_Size);
+
+	m_GameCount = m_SampleCount = 0;
+	m_MinGame = m_MaxGame = 0;
+}
+
+std::string_view TrainingShard::Finish()
+{
+	const size_t payloadSize = m_Data.size() - HeaderSize;
+	const std::span<const uint8_t> payload((const uint8_t *)m_Data.data() + HeaderSize, payloadSize);
+
+	std::string header;
+	header.reserve(HeaderSize);
+	WriteUint32(header, Magic);
+	header.push_back((char)Version);
+	header.append(3, 0);
+	WriteUint32(header, m_Size);
+	WriteUint32(header, payloadSize);
+	WriteUint32(header, m_GameCount);
+	WriteUint32(header, m_SampleCount);
+	WriteUint64(header, m_MinGame);
+	WriteUint64(header, m_MaxGame);
+	WriteUint32(header, Crc32(payload));
+	header.resize(HeaderSize - 4, 0);
+	WriteUint32(header, Crc32(std::span((const uint8_t *)header.data(), header.size())));
+
+	m_Data.replace(0, HeaderSize, header);
+	m_Data.resize(m_Size, 0);
+
+	return std::string_view(m_Data.data(), m_Size);
+}
+
+TrainingShard::Header TrainingShard::ReadHeader(std::span<const uint8_t> data)
+{
+	if (data.size() < HeaderSize)
+		throw std::runtime_error("Truncated shard header");
+
+	if (ReadUint32(data, 0) != Magic || data[4] != Version)
+		throw std::runtime_error("Not a training shard or unsupported version");
+
+	if (ReadUint32(data, HeaderSize - 4) != Crc32(data.first(HeaderSize - 4)))
+		throw std::runtime_error("Shard header checksum mismatch");
+
+	const Header header = {
+		.Size = ReadUint32(data, 8),
+		.PayloadSize = ReadUint32(data, 12),
+		.GameCount = ReadUint32(data, 16),
+		.SampleCount = ReadUint32(data, 20),
+		.MinGame = ReadUint64(data, 24),
+		.MaxGame = ReadUint64(data, 32),
+		.PayloadCrc = ReadUint32(data, 40)
+	};
+
+	if (header.PayloadSize > header.Size - HeaderSize)
+		throw std::runtime_error("Shard payload exceeds the shard size");
+
+	return header;
+}
+
+std::vector<TrainingGame> TrainingShard::Read(std::span<const uint8_t> data)
+{
+	const Header header = ReadHeader(data);
+	if (data.size() != header.Size)
+		throw std::runtime_error(std::format("Shard has {} bytes instead of {}", data.size(), header.Size));
+
+	const std::span<const uint8_t> payload = data.subspan(HeaderSize, header.PayloadSize);
+	if (Crc32(payload) != header.PayloadCrc)
+		throw std::runtime_error("Shard payload checksum mismatch");
+
+	std::vector<TrainingGame> games(header.GameCount);
+
+	size_t offset = 0;
+	for (TrainingGame &game : games)
+	{
+		game.Index = ReadVarint(payload, offset);
+
+		if (offset + 15 > payload.size())
+			throw std::runtime_error("Truncated game in shard");
+
+		game.Start = Position{
+			ReadUint32(payload, offset), ReadUint32(payload, offset + 4), ReadUint32(payload, offset + 8),
+			(int8_t)payload[offset + 12], payload[offset + 13] != 0
+		};
+		if (payload[offset + 14] > (uint8_t)GameResult::Draw)
+			throw std::runtime_error("Invalid result in shard");
+		game.Result = (GameResult)payload[offset + 14];
+		offset += 15;
+
+		const uint64_t moveCount = ReadVarint(payload, offset);
+		if (moveCount > payload.size() - offset)
+			throw std::runtime_error("Move count exceeds shard payload");
+
+		game.Moves.resize(moveCount);
+		game.Visits.resize(moveCount);
+		for (size_t i = 0; i < moveCount; i++)
+		{
+			game.Moves[i] = ReadVarint(payload, offset);
+
+			const uint64_t visitCount = ReadVarint(payload, offset);
+			if (visitCount > payload.size() - offset)
+				throw std::runtime_error("Visit count exceeds shard payload");
+
+			game.Visits[i].resize(visitCount);
+			for (uint32_t &visits : game.Visits[i])
+				visits = ReadVarint(payload, offset);
+		}
+	}
+
+	if (offset != payload.size())
+		throw std::runtime_error("Shard payload size mismatch");
+
+	return games;
+}
+
+static std::filesystem::path GetShardPath(const std::filesystem::path &directory, uint64_t index)
+{
+	return directory / std::format("shard-{:06}.ckts", index);
+}
+
+std::vector<std::filesystem::path> ShardWriter::GetShards(const std::filesystem::path &directory)
+{
+	std::vector<std::filesystem::path> shards;
+	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory))
+	{
+		const std::string name = entry.path().filename().string();
+		if (entry.is_regular_file() && name.starts_with("shard-") && name.ends_with(".ckts"))
+			shards.push_back(entry.path());
+	}
+
+	std::sort(shards.begin(), shards.end());
+	return shards;
+}
+
+ShardWriter::Contents ShardWriter::Scan(const std::filesystem::path &directory)
+{
+	Contents contents = {};
+
+	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory))
+	{
+		const std::string name = entry.path().filename().string();
+		if (!name.starts_with("shard-"))
+			continue;
+
+		if (name.ends_with(".tmp"))
+		{
+			std::filesystem::remove(entry.path());
+			contents.Removed++;
+			continue;
+		}
+
+		// Corrupt shards keep their number, so it isn't reused
+		contents.NextShard = std::max<uint64_t>(contents.NextShard, std::strtoull(name.c_str() + 6, nullptr, 10) + 1);
+	}
+
+	for (const std::filesystem::path &path : GetShards(directory))
+	{
+		std::vector<uint8_t> header(TrainingShard::HeaderSize);
+		std::ifstream file(path, std::ios::binary);
+		file.read((char *)header.data(), header.size());
+		header.resize(file.gcount());
+
+		try
+		{
+			const TrainingShard::Header values = TrainingShard::ReadHeader(header);
+			if (std::filesystem::file_size(path) != values.Size)
+				throw std::runtime_error("Truncated shard");
+
+			contents.Shards++;
+			contents.Games += values.GameCount;
+			contents.Samples += values.SampleCount;
+			if (values.GameCount != 0)
+				contents.NextGame = std::max(contents.NextGame, values.MaxGame + 1);
+		}
+		catch (const std::runtime_error &)
+		{
+			file.close();
+			std::filesystem::rename(path, std::filesystem::path(path).concat(".corrupt"));
+			contents.Corrupt++;
+		}
+	}
+
+	return contents;
+}
+
+ShardWriter::ShardWriter(const std::filesystem::path &directory, size_t shardSize)
+	: m_Directory(directory), m_Filling(shardSize), m_Writing(shardSize)
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error)
+		throw std::runtime_error(std::format("Can't create {}: {}", directory.string(), error.message()));
+
+	m_Resumed = Scan(directory);
+	m_NextShard = m_Resumed.NextShard;
+
+	m_Writer = std::thread(&ShardWriter::WriterLoop, this);
+}
+
+ShardWriter::~ShardWriter()
+{
+	try
+	{
+		Close();
+	}
+	catch (const std::exception &)
+	{
+	}
+}
+
+void ShardWriter::Add(const TrainingGame &game)
+{
+	std::unique_lock lock(m_Mutex);
+	if (m_Error)
+		std::rethrow_exception(m_Error);
+
+	if (m_Filling.Add(game))
+		return;
+
+	const std::chrono::time_point start(std::chrono::steady_clock::now());
+	m_Written.wait(lock, [&] { return !m_HasPending; });
+	m_Stats.Stalled += std::chrono::steady_clock::now() - start;
+
+	if (m_Error)
+		std::rethrow_exception(m_Error);
+
+	std::swap(m_Filling, m_Writing);
+	m_HasPending = true;
+	m_Pending.notify_one();
+
+	m_Filling.Clear();
+	m_Filling.Add(game);
+}
+
+void ShardWriter::Close()
+{
+	if (!m_Writer.joinable())
+		return;
+
+	{
+		std::unique_lock lock(m_Mutex);
+		m_Written.wait(lock, [&] { return !m_HasPending; });
+
+		if (!m_Filling.IsEmpty())
+		{
+			std::swap(m_Filling, m_Writing);
+			m_Filling.Clear();
+			m_HasPending = true;
+		}
+		m_Closing = true;
+	}
+	m_Pending.notify_one();
+	m_Writer.join();
+
+	if (m_Error)
+		std::rethrow_exception(m_Error);
+}
+
+ShardWriter::Stats ShardWriter::GetStats() const
+{
+	std::lock_guard lock(m_Mutex);
+	return m_Stats;
+}
+
+void ShardWriter::WriterLoop()
+{
+	std::unique_lock lock(m_Mutex);
+	while (true)
+	{
+		m_Pending.wait(lock, [&] { return m_Closing || m_HasPending; });
+		if (!m_HasPending)
+			return;
+
+		// Producers don't touch m_Writing while it's pending
+		const uint64_t index = m_NextShard++;
+		lock.unlock();
+
+		const std::string_view data = m_Writing.Finish();
+
+		std::exception_ptr error = nullptr;
+		try
+		{
+			WriteShard(index, data);
+		}
+		catch (const std::exception &)
+		{
+			error = std::current_exception();
+		}
+
+		lock.lock();
+		if (error)
+			m_Error = error;
+		else
+		{
+			m_Stats.Shards++;
+			m_Stats.Games += m_Writing.GetGameCount();
+			m_Stats.Samples += m_Writing.GetSampleCount();
+			m_Stats.Bytes += data.size();
+		}
+
+		m_HasPending = false;
+		m_Written.notify_all();
+	}
+}
+
+void ShardWriter::WriteShard(uint64_t index, std::string_view data)
+{
+	const std::filesystem::path path = GetShardPath(m_Directory, index);
+	const std::filesystem::path temporary = std::filesystem::path(path).concat(".tmp");
+
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		file.write(data.data(), data.size());
+		file.close();
+
+		if (!file)
+			throw std::runtime_error(std::format("Can't write {}", temporary.string()));
+	}
+
+	std::filesystem::rename(temporary, path);
+}
+
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "GameRecord.h"
+#include "MoveGenerator.h"
+#include "Position.h"
+
+namespace Checkers
+{
+
+// A self-play game with the root visit counts of every searched position
+struct TrainingGame
+{
+	// Number of the game in its run
+	uint64_t Index = 0;
+
+	Position Start = StartingPosition;
+	GameResult Result = GameResult::Unfinished;
+
+	// Indices into the moves of MoveGenerator
+	std::vector<uint16_t> Moves = {};
+
+	// One entry per move with the visits of every legal move in MoveGenerator order
+	// Empty for a forced move, which is played without a search and gives no sample
+	std::vector<std::vector<uint32_t>> Visits = {};
+
+	size_t GetSampleCount() const;
+};
+
+struct TrainingSample
+{
+	Checkers::Position Position;
+
+	// Points into the game the sample was taken from
+	std::span<const uint32_t> Visits;
+
+	// Final result for the side to move: 1 win, 0 draw, -1 loss
+	int Value;
+};
+
+// Replays the game and appends its samples, moves is scratch space
+// Throws std::runtime_error on an illegal move, a visit list of the wrong length or a wrong result
+void GetSamples(const TrainingGame &game, std::vector<TrainingSample> &samples, std::vector<Move> &moves);
+
+// Fixed-size block of games: a checksummed header, the encoded games and zero padding
+// Header (little endian): magic, version, shard size, payload size, game and sample counts,
+// lowest and highest game index, payload CRC-32, header CRC-32
+class TrainingShard
+{
+public:
+	static constexpr uint32_t Magic = 0x53544b43u;
+	static constexpr uint8_t Version = 1;
+	static constexpr size_t HeaderSize = 64;
+	static constexpr size_t DefaultSize = 4 << 20;
+
+	struct Header
+	{
+		uint32_t Size, PayloadSize;
+		uint32_t GameCount, SampleCount;
+		uint64_t MinGame, MaxGame;
+		uint32_t PayloadCrc;
+	};
+
+	explicit TrainingShard(size_t size = DefaultSize);
+
+	// Returns false if the game doesn't fit, throws std::length_error if it wouldn't fit into an empty shard
+	bool Add(const TrainingGame &game);
+	void Clear();
+
+	bool IsEmpty() const { return m_GameCount == 0; }
+	size_t GetGameCount() const { return m_GameCount; }
+	size_t GetSampleCount() const { return m_SampleCount; }
+
+	// Fills in the header and the padding, valid until the next Add or Clear
+	std::string_view Finish();
+
+	// Throws std::runtime_error on a bad magic, version or header checksum
+	static Header ReadHeader(std::span<const uint8_t> data);
+
+	// Also verifies the payload checksum
+	static std::vector<TrainingGame> Read(std::span<const uint8_t> data);
+
+private:
+	size_t m_Size;
+	std::string m_Data;
+	std::string m_Entry;
+
+	uint32_t m_GameCount = 0, m_SampleCount = 0;
+	uint64_t m_MinGame = 0, m_MaxGame = 0;
+};
+
+// Directory of shards named shard-000000.ckts, shard-000001.ckts, ...
+// Add fills one shard while a background thread writes the previous one out
+// A shard is written to a temporary file and renamed when complete, so an interrupted run leaves only whole shards
+class ShardWriter
+{
+public:
+	struct Stats
+	{
+		uint64_t Shards, Games, Samples, Bytes;
+
+		// Time producers waited for the writer because both shards were full
+		std::chrono::nanoseconds Stalled;
+	};
+
+	// What an earlier run left in a directory
+	struct Contents
+	{
+		uint64_t NextShard, NextGame;
+		uint64_t Shards, Games, Samples;
+
+		// Leftover temporary files are deleted, shards with a bad header are renamed to *.corrupt
+		size_t Removed, Corrupt;
+	};
+
+	// Numbering continues after the shards already in the directory, throws std::runtime_error if it can't be used
+	ShardWriter(const std::filesystem::path &directory, size_t shardSize = TrainingShard::DefaultSize);
+	~ShardWriter();
+
+	// Blocks while the previous full shard is still being written, rethrows a failed write
+	void Add(const TrainingGame &game);
+
+	// Writes out the partially filled shard and stops the writer thread
+	void Close();
+
+	Stats GetStats() const;
+	const Contents &GetResumed() const { return m_Resumed; }
+
+	static Contents Scan(const std::filesystem::path &directory);
+	static std::vector<std::filesystem::path> GetShards(const std::filesystem::path &directory);
+
+private:
+	std::filesystem::path m_Directory;
+	Contents m_Resumed;
+	uint64_t m_NextShard;
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_Pending, m_Written;
+
+	TrainingShard m_Filling, m_Writing;
+	bool m_HasPending = false, m_Closing = false;
+	std::exception_ptr m_Error = nullptr;
+	Stats m_Stats = {};
+
+	std::thread m_Writer;
+
+	void WriterLoop();
+	void WriteShard(uint64_t index, std::string_view data);
+};
+
+}
@@ -6,8 +6,10 @@
 #include <imgui.h>
 
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
+#include "Controllers/Simulator.h"
 #include "Core/Core.h"
 #include "Renderer/Renderer.h"
 
@@ -19,7 +21,7 @@ namespace Checkers
 
 static void GlfwErrorCallback(int error, const char *description)
 {
-	throw std::exception(std::format("GLFW error {} {}", error, description).c_str());
+	throw std::runtime_error(std::format("GLFW error {} {}", error, description));
 }
 
 Window::Window(int width, int height, const char *title, bool vsync)
@@ -30,7 +32,7 @@ Window::Window(int width, int height, const char *title, bool vsync)
 
 #ifndef NDEBUG
 	if (result == GLFW_FALSE)
-		throw new std::exception("Glfw initialization failed!");
+		throw std::runtime_error("Glfw initialization failed!");
 #endif
 
 	glfwSetErrorCallback(GlfwErrorCallback);
@@ -42,7 +44,7 @@ Window::Window(int width, int height, const char *title, bool vsync)
 	
 #ifndef NDEBUG
 	if (m_Handle == nullptr)
-		throw new std::exception("Window creation failed!");
+		throw std::runtime_error("Window creation failed!");
 #endif
 
 	glfwMakeContextCurrent(m_Handle);
@@ -52,7 +54,7 @@ Window::Window(int width, int height, const char *title, bool vsync)
 
 #ifndef NDEBUG
 	if (result == GLFW_FALSE)
-		throw new std::exception("glad initalization failed!");
+		throw std::runtime_error("glad initalization failed!");
 #endif
 
 	IMGUI_CHECKVERSION();
@@ -187,7 +189,9 @@ void Window::OnRender()
 		Game::SelectBlackPlayer(ControllerType::PlayerController);
 	if (ImGui::RadioButton("Computer (CPU)", Game::GetBlackPlayerType() == ControllerType::ComputerHostController))
 		Game::SelectBlackPlayer(ControllerType::ComputerHostController);
-	if (ImGui::RadioButton("Computer (GPU)", Game::GetBlackPlayerType() == ControllerType::ComputerDeviceController))
+	if (ImGui::RadioButton("Computer (CPU, threaded)", Game::GetBlackPlayerType() == ControllerType::ComputerThreadedHostController))
+		Game::SelectBlackPlayer(ControllerType::ComputerThreadedHostController);
+	if (Simulator::IsDeviceAvailable() && ImGui::RadioButton("Computer (GPU)", Game::GetBlackPlayerType() == ControllerType::ComputerDeviceController))
 		Game::SelectBlackPlayer(ControllerType::ComputerDeviceController);
 	ImGui::PopID();
 
@@ -197,7 +201,9 @@ void Window::OnRender()
 		Game::SelectWhitePlayer(ControllerType::PlayerController);
 	if (ImGui::RadioButton("Computer (CPU)", Game::GetWhitePlayerType() == ControllerType::ComputerHostController))
 		Game::SelectWhitePlayer(ControllerType::ComputerHostController);
-	if (ImGui::RadioButton("Computer (GPU)", Game::GetWhitePlayerType() == ControllerType::ComputerDeviceController))
+	if (ImGui::RadioButton("Computer (CPU, threaded)", Game::GetWhitePlayerType() == ControllerType::ComputerThreadedHostController))
+		Game::SelectWhitePlayer(ControllerType::ComputerThreadedHostController);
+	if (Simulator::IsDeviceAvailable() && ImGui::RadioButton("Computer (GPU)", Game::GetWhitePlayerType() == ControllerType::ComputerDeviceController))
 		Game::SelectWhitePlayer(ControllerType::ComputerDeviceController);
 	ImGui::PopID();
 
@@ -230,7 +236,7 @@ void Window::OnRender()
 
 	ImGui::Render();
 	Renderer::Resize((uint32_t)m_ViewportSize.x, (uint32_t)m_ViewportSize.y);
-	Renderer::Render();
+	Renderer::Render(Game::GetPosition());
 
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 	glfwSwapBuffers(m_Handle);
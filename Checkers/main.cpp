@@ -1,6 +1,10 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 #include "Core/Core.h"
+#include "Core/Telemetry.h"
 #include "Renderer/Renderer.h"
 
 #include "Game.h"
@@ -10,26 +14,72 @@ using namespace Checkers;
 
 int main(int argc, char *argv[])
 {
+	const std::chrono::time_point start(std::chrono::steady_clock::now());
+	bool warmUp = false;
+	TimeControl timeControl;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			if (!Trace::Start(argv[++i]))
+				std::cerr << "Can't create trace file " << argv[i] << std::endl;
+		}
+		else if (std::strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc)
+		{
+			if (!Telemetry::Open(argv[++i]))
+				std::cerr << "Can't open telemetry file " << argv[i] << std::endl;
+		}
+		else if (std::strcmp(argv[i], "--warmup") == 0)
+			warmUp = true;
+		else if (std::strcmp(argv[i], "--time-control") == 0 && i + 1 < argc)
+		{
+			// base+increment in seconds, e.g. 60+1
+			char *end;
+			const double base = std::strtod(argv[++i], &end);
+			const double increment = *end == '+' ? std::strtod(end + 1, nullptr) : 0.0;
+
+			timeControl.Base = std::chrono::milliseconds((long long)(base * 1000));
+			timeControl.Increment = std::chrono::milliseconds((long long)(increment * 1000));
+		}
+		else if (std::strcmp(argv[i], "--perf") == 0)
+		{
+			if (!Instrumentation::EnablePerfCounters())
+				std::cerr << "Hardware performance counters are not available" << std::endl;
+		}
+	}
+
 	try
 	{
 		Window window(1280, 720, "Checkers", true);
 
-		Game::Init(&window);
+		Game::Init(&window, warmUp, timeControl);
 		Game::Start();
-		Renderer::Init(Game::GetPosition());
+		Renderer::Init();
 
+		bool firstFrame = true;
 		while (!window.ShouldClose())
 		{
 			window.OnUpdate();
 			window.OnRender();
 
+			if (firstFrame)
+			{
+				firstFrame = false;
+				Stats::AddStat("Startup Frame", "Time to first frame: {:.1f} ms",
+					std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+				);
+			}
+
 			window.WaitEvents();
 		}
 
 		Game::End();
 		Renderer::Shutdown();
+		Trace::Stop();
+		Telemetry::Close();
 	}
-	catch (std::exception exception)
+	catch (const std::exception &exception)
 	{
 		std::cerr << exception.what() << std::endl;
 